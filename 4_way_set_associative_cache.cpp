@@ -1,9 +1,20 @@
 #include <iostream>
+#include <sstream>
+#include <cstdio>
 #include <vector>
 #include <cstdint>
+#include <cstring>
+#include <cassert>
 #include <random>
 #include <cmath>
 #include <map>
+#include <algorithm>
+#include <unordered_set>
+#include <unordered_map>
+#include <thread>
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 using namespace std;
 
@@ -28,156 +39,4196 @@ public:
 class cache_line {
 public:
     bool valid;
+    bool dirty; // Line was written and differs from main memory (write-back only)
+    bool prefetched; // Filled by a prefetch and not yet referenced by a demand access
     size_t tag;
+    uint16_t asid;  // Address space that filled the line (ASID-tagged mode)
+    uint32_t epoch; // Context epoch of the fill; older epochs are stale (flush-on-switch mode)
     vector<uint8_t> cache_data;
     
     cache_line(size_t block_size) {
         valid = false;
+        dirty = false;
+        prefetched = false;
         tag = 0;
+        asid = 0;
+        epoch = 0;
         cache_data.resize(block_size, 0);
     }
 };
 
+// Policy applied when a store hits in the cache
+enum write_hit_policy { WRITE_BACK, WRITE_THROUGH };
+
+// Policy applied when a store misses in the cache
+enum write_miss_policy { WRITE_ALLOCATE, NO_WRITE_ALLOCATE };
+
+// How lines of different address spaces are kept apart: not at all, by matching an
+// ASID stored with the tag, or by invalidating the whole cache on a context switch
+enum asid_mode { ASID_NONE, ASID_TAGGED, ASID_FLUSH_ON_SWITCH };
+
 // Represents a single set in a set-associative cache
 class cache_set {
 public:
     vector<cache_line> lines; // Stores multiple cache lines
     vector<bool> plru_bits;   // 3-bit PLRU structure for 4-way associativity
+    uint8_t locked_ways;      // Bit i set: way i is locked and never replaced
+
+    cache_set(size_t block_size) {
+        locked_ways = 0;
+        plru_bits.resize(3, false);
+        lines.resize(NUM_WAYS, cache_line(block_size));
+    }
+
+    // Updates PLRU bits so that every node on the path points away from the accessed way
+    void updatePLRU(int accessedWay) {
+        plru_bits[0] = accessedWay < 2;
+        if (accessedWay < 2) {
+            plru_bits[1] = accessedWay == 0;
+        } else {
+            plru_bits[2] = accessedWay == 2;
+        }
+    }
+
+    // Determines which cache way should be replaced using PLRU policy. The walk never
+    // enters a subtree whose ways are all locked; returns -1 if every way is locked.
+    int findPLRUVictim() {
+        bool left_locked = (locked_ways & 0x3) == 0x3, right_locked = (locked_ways & 0xc) == 0xc;
+        if (left_locked && right_locked) {
+            return -1;
+        }
+        bool right = left_locked || (plru_bits[0] && !right_locked);
+        int way = right ? (plru_bits[2] ? 3 : 2) : (plru_bits[1] ? 1 : 0);
+        if (locked_ways & (1 << way)) {
+            way ^= 1;
+        }
+        return way;
+    }
+
+    // Points every node on the path at a way, making it the next victim (LRU insertion)
+    void demotePLRU(int way) {
+        plru_bits[0] = way >= 2;
+        if (way < 2) {
+            plru_bits[1] = way == 1;
+        } else {
+            plru_bits[2] = way == 3;
+        }
+    }
+};
+
+// Address fields of a DRAM location
+enum dram_field { FIELD_COLUMN, FIELD_CHANNEL, FIELD_BANK, FIELD_RANK, FIELD_ROW };
+
+// DRAM organization, timing (in cycles) and address mapping
+class dram_config {
+public:
+    size_t channels, ranks, banks, row_size;
+    uint64_t tRCD, tCAS, tRP, tBURST;
+    bool open_page;              // Keep rows open after an access (otherwise precharge at once)
+    vector<dram_field> mapping;  // Fields above the block offset, least significant first
+
+    dram_config() {
+        channels = 1;
+        ranks = 1;
+        banks = 8;
+        row_size = 8192;
+        tRCD = 14;
+        tCAS = 14;
+        tRP = 14;
+        tBURST = 4;
+        open_page = true;
+        mapping = {FIELD_COLUMN, FIELD_CHANNEL, FIELD_BANK, FIELD_RANK, FIELD_ROW};
+    }
+};
+
+// DRAM timing backend with channels, ranks, banks and row buffers. Block reads and
+// writes are queued per channel and scheduled first-ready, first-come-first-served
+// (FR-FCFS): among the requests that have arrived, row-buffer hits to idle banks go
+// first, then the oldest request whose bank becomes ready first. Scheduling is
+// event-driven and only runs up to the cycle the driver advances to.
+class dram_model {
+public:
+    struct dram_request {
+        size_t address;
+        bool is_write;
+        uint64_t arrival;
+        size_t rank, bank;
+        size_t row;
+    };
+
+    struct bank_state {
+        bool row_open;
+        size_t open_row;
+        uint64_t ready_at;
+    };
+
+    dram_config config;
+    size_t block_size;
+    uint64_t now;
+    vector<vector<dram_request>> queues;   // Pending requests per channel, oldest first
+    vector<vector<bank_state>> bank_states; // Per channel, indexed by rank * banks + bank
+    vector<uint64_t> bus_free_at, next_decision_at;
+    int reads, writes, row_hits, row_empty, row_conflicts;
+    uint64_t busy_bus_cycles, total_queue_latency, total_latency, last_completion;
+    uint64_t stats_start;  // Cycle of the last reset_stats(); utilization is measured from here
+
+    dram_model(const dram_config& config, size_t block_size) {
+        this->config = config;
+        this->block_size = block_size;
+        this->now = 0;
+        this->queues.resize(config.channels);
+        this->bank_states.resize(config.channels,
+                                 vector<bank_state>(config.ranks * config.banks, bank_state{false, 0, 0}));
+        this->bus_free_at.resize(config.channels, 0);
+        this->next_decision_at.resize(config.channels, 0);
+        reset_stats();
+    }
+
+    void reset_stats() {
+        reads = 0;
+        writes = 0;
+        row_hits = 0;
+        row_empty = 0;
+        row_conflicts = 0;
+        busy_bus_cycles = 0;
+        total_queue_latency = 0;
+        total_latency = 0;
+        last_completion = now;
+        stats_start = now;
+    }
+
+    // Queues a block read or write arriving at the current cycle
+    void enqueue(size_t address, bool is_write) {
+        size_t fields[5] = {0, 0, 0, 0, 0};
+        size_t sizes[5] = {config.row_size / block_size, config.channels, config.banks, config.ranks, 0};
+        size_t value = address / block_size;
+        for (dram_field field : config.mapping) {
+            if (field == FIELD_ROW) {
+                fields[field] = value;
+                break;
+            }
+            fields[field] = value % sizes[field];
+            value /= sizes[field];
+        }
+        queues[fields[FIELD_CHANNEL]].push_back(
+            {address, is_write, now, fields[FIELD_RANK], fields[FIELD_BANK], fields[FIELD_ROW]});
+    }
+
+    // Serves one request of a channel at decision time t
+    void serve(size_t channel, uint64_t t) {
+        vector<dram_request>& queue = queues[channel];
+        size_t chosen = queue.size();
+        uint64_t chosen_start = UINT64_MAX;
+        for (size_t i = 0; i < queue.size() && queue[i].arrival <= t; ++i) {
+            const bank_state& bank = bank_states[channel][queue[i].rank * config.banks + queue[i].bank];
+            uint64_t start = max(t, bank.ready_at);
+            if (start == t && bank.row_open && bank.open_row == queue[i].row) {
+                // First ready: the oldest row-buffer hit on an idle bank
+                chosen = i;
+                break;
+            }
+            if (start < chosen_start) {
+                // Otherwise the oldest request whose bank becomes ready first
+                chosen = i;
+                chosen_start = start;
+            }
+        }
+        dram_request request = queue[chosen];
+        queue.erase(queue.begin() + chosen);
+
+        // Column command time depends on the row-buffer state of the bank
+        bank_state& bank = bank_states[channel][request.rank * config.banks + request.bank];
+        uint64_t start = max(t, bank.ready_at);
+        uint64_t column_at;
+        if (bank.row_open && bank.open_row == request.row) {
+            row_hits++;
+            column_at = start;
+        } else if (bank.row_open) {
+            row_conflicts++;
+            column_at = start + config.tRP + config.tRCD;
+        } else {
+            row_empty++;
+            column_at = start + config.tRCD;
+        }
+        uint64_t data_at = max(column_at + config.tCAS, bus_free_at[channel]);
+        column_at = data_at - config.tCAS;
+        uint64_t done = data_at + config.tBURST;
+
+        // Open rows accept the next column command one burst later; closed-page
+        // banks precharge right after the transfer
+        bus_free_at[channel] = done;
+        bank.row_open = config.open_page;
+        bank.open_row = request.row;
+        bank.ready_at = config.open_page ? column_at + config.tBURST : done + config.tRP;
+        next_decision_at[channel] = start + 1;
+
+        (request.is_write ? writes : reads)++;
+        busy_bus_cycles += config.tBURST;
+        total_queue_latency += start - request.arrival;
+        total_latency += done - request.arrival;
+        last_completion = max(last_completion, done);
+    }
+
+    // Runs the schedulers for every decision that falls at or before the given cycle
+    void advance_to(uint64_t cycle) {
+        for (size_t channel = 0; channel < queues.size(); ++channel) {
+            while (!queues[channel].empty()) {
+                uint64_t t = max(next_decision_at[channel], queues[channel][0].arrival);
+                if (t > cycle) {
+                    break;
+                }
+                serve(channel, t);
+            }
+        }
+        now = max(now, cycle);
+    }
+
+    // Serves every queued request; time then stands at the last completion
+    void drain() {
+        uint64_t before = now;
+        advance_to(UINT64_MAX);
+        now = max(before, last_completion);
+    }
+
+    void print_stats() {
+        int requests = reads + writes;
+        uint64_t elapsed = max(last_completion - stats_start, (uint64_t)1);
+        cout << "DRAM (" << (config.open_page ? "open" : "closed") << " page): Reads: " << reads
+             << ", Writes: " << writes
+             << ", Row Hit Rate: " << (requests ? row_hits * 100.0 / requests : 0.0) << "%"
+             << " (hits " << row_hits << ", empty " << row_empty << ", conflicts " << row_conflicts << ")\n"
+             << "Bandwidth Utilization: " << busy_bus_cycles * 100.0 / (elapsed * config.channels) << "%"
+             << ", Avg Queueing Latency: " << (requests ? (double)total_queue_latency / requests : 0.0)
+             << " cycles, Avg Access Latency: " << (requests ? (double)total_latency / requests : 0.0)
+             << " cycles\n";
+    }
+};
+
+// Coalescing write buffer between a cache and main memory. Stores and writebacks are
+// merged into block-sized entries with byte masks and drained to memory, oldest
+// first, when occupancy reaches the drain threshold or an entry exceeds max_age ticks.
+class write_buffer {
+public:
+    class buffer_entry {
+    public:
+        size_t block_start;
+        uint64_t allocated_at;
+        vector<uint8_t> data;
+        vector<bool> byte_mask;
+
+        buffer_entry(size_t block_start, uint64_t allocated_at, size_t block_size) {
+            this->block_start = block_start;
+            this->allocated_at = allocated_at;
+            data.resize(block_size, 0);
+            byte_mask.resize(block_size, false);
+        }
+    };
+
+    size_t block_size, num_entries, drain_threshold;
+    uint64_t max_age, clock;
+    vector<buffer_entry> entries; // Oldest entry first
+    main_memory& memory;
+    dram_model* dram; // Optional DRAM timing backend receiving the drained writes
+    int stores_received, stores_coalesced, drain_events, memory_write_transactions, load_stalls;
+
+    write_buffer(size_t block_size, size_t num_entries, main_memory& main_mem,
+                 size_t drain_threshold = 0, uint64_t max_age = 64)
+        : memory(main_mem) {
+        this->dram = nullptr;
+        this->block_size = block_size;
+        this->num_entries = num_entries;
+        this->drain_threshold = drain_threshold ? drain_threshold : num_entries;
+        this->max_age = max_age;
+        this->clock = 0;
+        reset_stats();
+    }
+
+    void reset_stats() {
+        stores_received = 0;
+        stores_coalesced = 0;
+        drain_events = 0;
+        memory_write_transactions = 0;
+        load_stalls = 0;
+    }
+
+    // Returns the entry holding the block, or -1
+    int find_entry(size_t address) {
+        size_t block_start = (address / block_size) * block_size;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (entries[i].block_start == block_start) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // Writes the valid bytes of an entry to memory as one transaction
+    void drain_entry(size_t i) {
+        buffer_entry& entry = entries[i];
+        for (size_t b = 0; b < block_size; ++b) {
+            if (entry.byte_mask[b]) {
+                memory.memory_array[entry.block_start + b] = entry.data[b];
+            }
+        }
+        memory_write_transactions++;
+        if (dram) {
+            dram->enqueue(entry.block_start, true);
+        }
+        entries.erase(entries.begin() + i);
+    }
+
+    void drain_all() {
+        while (!entries.empty()) {
+            drain_entry(0);
+        }
+    }
+
+    // Advances the buffer clock by one access and drains entries that are too old
+    void tick() {
+        clock++;
+        if (!entries.empty() && clock - entries[0].allocated_at >= max_age) {
+            drain_events++;
+            while (!entries.empty() && clock - entries[0].allocated_at >= max_age) {
+                drain_entry(0);
+            }
+        }
+    }
+
+    // Buffers a store of len bytes (within one block), merging with a pending entry
+    void write(size_t address, const uint8_t* src, size_t len) {
+        stores_received++;
+        int i = find_entry(address);
+        if (i != -1) {
+            stores_coalesced++;
+        } else {
+            if (entries.size() == num_entries) {
+                drain_events++;
+                drain_entry(0);
+            }
+            entries.push_back(buffer_entry((address / block_size) * block_size, clock, block_size));
+            i = entries.size() - 1;
+        }
+
+        size_t offset = address % block_size;
+        memcpy(&entries[i].data[offset], src, len);
+        for (size_t b = offset; b < offset + len; ++b) {
+            entries[i].byte_mask[b] = true;
+        }
+
+        if (entries.size() >= drain_threshold) {
+            drain_events++;
+            drain_entry(0);
+        }
+    }
+
+    // A load to a block with pending stores stalls until that entry has drained
+    void stall_load(size_t address) {
+        int i = find_entry(address);
+        if (i != -1) {
+            load_stalls++;
+            drain_entry(i);
+        }
+    }
+
+    void print_stats() {
+        cout << "Write Buffer: Stores: " << stores_received << ", Coalesced: " << stores_coalesced
+             << ", Drain Events: " << drain_events
+             << ", Memory Write Transactions: " << memory_write_transactions
+             << " (saved " << stores_received - memory_write_transactions << ")"
+             << ", Load Stalls: " << load_stalls << "\n";
+    }
+};
+
+// Why a write reaches memory: an explicit clwb/clflush, the eviction of a dirty line,
+// or a store that bypasses the cache (write-through, no-allocate or non-temporal)
+enum persist_cause { PERSIST_EXPLICIT, PERSIST_EVICTION, PERSIST_STORE };
+
+// Accounts the writes that reach a persistent-memory range through a cache. Explicit
+// flushes and cache-bypassing stores are ordered by the next fence, which records
+// how many distinct lines were pending; evictions reach the media unordered. The
+// media is written in media_block-byte units: without a combining buffer every
+// write costs one media write per unit it touches, with one (like the XPBuffer) the
+// last combine_entries units are merged and written when they leave the buffer.
+class pmem_tracker {
+public:
+    size_t range_start, range_end;  // Persistent addresses
+    size_t line_size, media_block, combine_entries;
+    vector<size_t> combine_buffer;  // Media units, most recently written first
+    int explicit_writebacks, natural_writebacks, direct_stores, fences, combined_writes, media_writes;
+    uint64_t bytes_written;
+    unordered_set<size_t> pending_lines;  // Lines flushed or stored since the last fence
+    map<size_t, int> pending_per_fence;   // Pending lines at a fence -> fences
+
+    pmem_tracker(size_t range_start, size_t range_end, size_t line_size = 64, size_t media_block = 256,
+                 size_t combine_entries = 0) {
+        this->range_start = range_start;
+        this->range_end = range_end;
+        this->line_size = line_size;
+        this->media_block = media_block;
+        this->combine_entries = combine_entries;
+        this->explicit_writebacks = 0;
+        this->natural_writebacks = 0;
+        this->direct_stores = 0;
+        this->fences = 0;
+        this->combined_writes = 0;
+        this->media_writes = 0;
+        this->bytes_written = 0;
+    }
+
+    void on_write(size_t address, size_t len, persist_cause cause) {
+        if (address < range_start || address >= range_end) {
+            return;
+        }
+        bytes_written += len;
+        if (cause == PERSIST_EVICTION) {
+            natural_writebacks++;
+        } else {
+            if (cause == PERSIST_EXPLICIT) {
+                explicit_writebacks++;
+            } else {
+                direct_stores++;
+            }
+            pending_lines.insert(address / line_size);
+        }
+        for (size_t unit = address / media_block; unit <= (address + len - 1) / media_block; ++unit) {
+            if (!combine_entries) {
+                media_writes++;
+                continue;
+            }
+            auto it = find(combine_buffer.begin(), combine_buffer.end(), unit);
+            if (it != combine_buffer.end()) {
+                combine_buffer.erase(it);
+                combined_writes++;
+            } else if (combine_buffer.size() == combine_entries) {
+                combine_buffer.pop_back();
+                media_writes++;
+            }
+            combine_buffer.insert(combine_buffer.begin(), unit);
+        }
+    }
+
+    // sfence: the pending flushes and stores are now ordered
+    void fence() {
+        fences++;
+        pending_per_fence[pending_lines.size()]++;
+        pending_lines.clear();
+    }
+
+    // Writes the combining buffer to the media
+    void drain() {
+        media_writes += combine_buffer.size();
+        combine_buffer.clear();
+    }
+
+    void print_stats() {
+        cout << "Persistent Writes: Explicit Writebacks: " << explicit_writebacks
+             << ", Natural Writebacks: " << natural_writebacks << ", Direct Stores: " << direct_stores
+             << ", Bytes: " << bytes_written << "\n";
+        cout << "Media Writes (" << media_block << " B): " << media_writes << ", Combined: " << combined_writes
+             << ", Write Amplification: "
+             << (bytes_written ? (double)media_writes * media_block / bytes_written : 0.0) << "x\n";
+        cout << "Fences: " << fences << ", Pending Lines per Fence:";
+        for (const auto& bucket : pending_per_fence) {
+            cout << " " << bucket.first << ":" << bucket.second;
+        }
+        cout << "\n";
+    }
+};
+
+// How a virtual-to-physical translation layer picks frames for new pages
+enum frame_allocation_policy { ALLOC_SEQUENTIAL, ALLOC_RANDOM, ALLOC_PAGE_COLORING };
+
+// Maps virtual pages to physical frames on first touch, so that physically indexed
+// caches see OS page placement. Page coloring gives a page a frame whose cache set
+// bits above the page offset (its color) match those of the virtual page. The page
+// table is an open-addressing hash table of 64-bit keys and 32-bit frame numbers.
+// When every frame is in use, allocation wraps around and frames are shared.
+class address_translator {
+public:
+    size_t page_size, num_frames, num_colors;
+    frame_allocation_policy policy;
+    vector<uint64_t> table_keys;    // Virtual page number + 1, 0 when empty
+    vector<uint32_t> table_frames;
+    size_t table_used;
+    vector<uint32_t> frame_order;   // Allocation order for ALLOC_RANDOM
+    vector<size_t> next_in_color;   // Next frame index per color
+    size_t next_frame;
+    int pages_mapped, frames_reused;
+
+    // way_size is the cache capacity of one way (sets * block size)
+    address_translator(size_t page_size, size_t memory_size, size_t way_size,
+                       frame_allocation_policy policy, unsigned seed = 1) {
+        this->page_size = page_size;
+        this->num_frames = memory_size / page_size;
+        this->num_colors = max((size_t)1, way_size / page_size);
+        this->policy = policy;
+        this->table_keys.resize(64, 0);
+        this->table_frames.resize(64, 0);
+        this->table_used = 0;
+        this->next_in_color.resize(num_colors, 0);
+        this->next_frame = 0;
+        this->pages_mapped = 0;
+        this->frames_reused = 0;
+        if (policy == ALLOC_RANDOM) {
+            for (size_t f = 0; f < num_frames; ++f) {
+                frame_order.push_back(f);
+            }
+            mt19937 gen(seed);
+            shuffle(frame_order.begin(), frame_order.end(), gen);
+        }
+    }
+
+    size_t slot_of(uint64_t key) {
+        uint64_t h = key * 0x9E3779B97F4A7C15ULL;
+        return (h ^ (h >> 29)) & (table_keys.size() - 1);
+    }
+
+    // Doubles the table when it is half full
+    void grow_table() {
+        vector<uint64_t> old_keys;
+        vector<uint32_t> old_frames;
+        old_keys.swap(table_keys);
+        old_frames.swap(table_frames);
+        table_keys.resize(old_keys.size() * 2, 0);
+        table_frames.resize(old_frames.size() * 2, 0);
+        for (size_t i = 0; i < old_keys.size(); ++i) {
+            if (old_keys[i]) {
+                size_t slot = slot_of(old_keys[i]);
+                while (table_keys[slot]) {
+                    slot = (slot + 1) & (table_keys.size() - 1);
+                }
+                table_keys[slot] = old_keys[i];
+                table_frames[slot] = old_frames[i];
+            }
+        }
+    }
+
+    // Picks a frame for a newly touched virtual page
+    size_t allocate_frame(size_t vpn) {
+        size_t allocated = pages_mapped++;
+        if (allocated >= num_frames) {
+            frames_reused++;
+        }
+        if (policy == ALLOC_RANDOM) {
+            return frame_order[allocated % num_frames];
+        }
+        if (policy == ALLOC_PAGE_COLORING) {
+            // Frames of one color are color, color + num_colors, color + 2 * num_colors, ...
+            size_t color = vpn % num_colors;
+            size_t frames_in_color = (num_frames - color + num_colors - 1) / num_colors;
+            size_t frame = color + (next_in_color[color]++ % frames_in_color) * num_colors;
+            return frame;
+        }
+        return next_frame++ % num_frames;
+    }
+
+    // Returns the table slot holding the page of vaddr, or the empty slot it would take
+    size_t find_slot(size_t vaddr) {
+        uint64_t key = (uint64_t)(vaddr / page_size) + 1;
+        size_t slot = slot_of(key);
+        while (table_keys[slot] && table_keys[slot] != key) {
+            slot = (slot + 1) & (table_keys.size() - 1);
+        }
+        return slot;
+    }
+
+    // Translates vaddr without mapping its page; returns false if the page was never touched
+    bool lookup(size_t vaddr, size_t& paddr) {
+        size_t slot = find_slot(vaddr);
+        if (!table_keys[slot]) {
+            return false;
+        }
+        paddr = (size_t)table_frames[slot] * page_size + vaddr % page_size;
+        return true;
+    }
+
+    size_t translate(size_t vaddr) {
+        size_t vpn = vaddr / page_size;
+        uint64_t key = (uint64_t)vpn + 1;
+        size_t slot = find_slot(vaddr);
+        if (!table_keys[slot]) {
+            if (2 * (table_used + 1) > table_keys.size()) {
+                grow_table();
+                return translate(vaddr);
+            }
+            table_keys[slot] = key;
+            table_frames[slot] = (uint32_t)allocate_frame(vpn);
+            table_used++;
+        }
+        return (size_t)table_frames[slot] * page_size + vaddr % page_size;
+    }
+
+    void print_stats() {
+        const char* policy_names[] = {"Sequential", "Random", "Page Coloring"};
+        cout << "Translation (" << policy_names[policy] << "): Pages Mapped: " << pages_mapped
+             << ", Colors: " << num_colors << ", Frames Reused: " << frames_reused
+             << ", Page Table: " << table_keys.size() * (sizeof(uint64_t) + sizeof(uint32_t)) << " bytes\n";
+    }
+};
+
+// Kind of memory reference carried by a trace record
+// Cache maintenance records (clflush, clwb, invd) act on the blocks of
+// [address, address + size); a fence (sfence) orders the flushes before it
+enum access_type { ACCESS_READ, ACCESS_WRITE, ACCESS_IFETCH, ACCESS_FLUSH, ACCESS_CLEAN, ACCESS_INVALIDATE,
+                   ACCESS_FENCE, ACCESS_CONTEXT_SWITCH };
+
+// Software hint carried by a reference: a non-temporal access (streaming loads and
+// stores), a prefetch that returns no data, or a fill inserted at the LRU position
+enum access_hint { HINT_NONE, HINT_NON_TEMPORAL, HINT_PREFETCH_ONLY, HINT_EVICT_FIRST };
+
+// One memory reference of an access trace
+struct trace_record {
+    size_t address;
+    access_type type;
+    uint8_t value;  // Byte stored by writes
+    uint64_t cycle; // Issue cycle (or instruction count) used by the timing model
+    uint32_t size;  // Bytes referenced, e.g. the length of a fetched instruction
+    access_hint hint;
+    uint16_t asid;  // Address space issuing the reference; the new one for context switches
+};
+
+// True for loads, stores and fetches; false for maintenance, fence and context-switch
+// records, which reference no data and must not be replayed as reads
+bool is_memory_reference(access_type type) {
+    return type == ACCESS_READ || type == ACCESS_WRITE || type == ACCESS_IFETCH;
+}
+
+// True for the flush, clean and invalidate records
+bool is_maintenance(access_type type) {
+    return type == ACCESS_FLUSH || type == ACCESS_CLEAN || type == ACCESS_INVALIDATE;
+}
+
+// Interface for hardware prefetchers attached to a set-associative cache. The cache
+// calls on_access() after every demand access with its outcome; a prefetch hit is
+// the first demand hit on a prefetched line. Predicted addresses are appended to
+// prefetches, and the cache filters those that are already cached or in flight.
+class prefetcher {
+public:
+    virtual ~prefetcher() {}
+    virtual void on_access(size_t pc, size_t address, bool hit, bool prefetch_hit,
+                           vector<size_t>& prefetches) = 0;
+};
+
+// Prefetches the next degree blocks after every miss or prefetch hit
+class next_line_prefetcher : public prefetcher {
+public:
+    size_t block_size, degree;
+
+    next_line_prefetcher(size_t block_size, size_t degree) {
+        this->block_size = block_size;
+        this->degree = degree;
+    }
+
+    void on_access(size_t, size_t address, bool hit, bool prefetch_hit,
+                   vector<size_t>& prefetches) override {
+        if (hit && !prefetch_hit) {
+            return;
+        }
+        size_t block_start = (address / block_size) * block_size;
+        for (size_t i = 1; i <= degree; ++i) {
+            prefetches.push_back(block_start + i * block_size);
+        }
+    }
+};
+
+// PC-indexed stride prefetcher using a reference prediction table (Chen and Baer).
+// Each entry tracks the last address and stride of one load instruction and
+// prefetches degree strides ahead once the stride has been confirmed.
+class stride_prefetcher : public prefetcher {
+public:
+    enum rpt_state { INITIAL, TRANSIENT, STEADY, NO_PREDICTION };
+
+    struct rpt_entry {
+        size_t pc;
+        size_t last_address;
+        long long stride;
+        rpt_state state;
+        bool valid;
+    };
+
+    size_t degree;
+    vector<rpt_entry> table;
+
+    stride_prefetcher(size_t table_size, size_t degree) {
+        this->degree = degree;
+        this->table.resize(table_size, rpt_entry{0, 0, 0, INITIAL, false});
+    }
+
+    void on_access(size_t pc, size_t address, bool, bool,
+                   vector<size_t>& prefetches) override {
+        rpt_entry& entry = table[pc % table.size()];
+        if (!entry.valid || entry.pc != pc) {
+            entry = rpt_entry{pc, address, 0, INITIAL, true};
+            return;
+        }
+
+        long long stride = (long long)address - (long long)entry.last_address;
+        bool correct = stride == entry.stride;
+        switch (entry.state) {
+        case INITIAL:
+            entry.state = correct ? STEADY : TRANSIENT;
+            break;
+        case TRANSIENT:
+            entry.state = correct ? STEADY : NO_PREDICTION;
+            break;
+        case STEADY:
+            entry.state = correct ? STEADY : INITIAL;
+            break;
+        case NO_PREDICTION:
+            entry.state = correct ? TRANSIENT : NO_PREDICTION;
+            break;
+        }
+        // A steady entry keeps its stride through one misprediction
+        if (!correct && entry.state != INITIAL) {
+            entry.stride = stride;
+        }
+        entry.last_address = address;
+
+        if (entry.state == STEADY && entry.stride != 0) {
+            for (size_t i = 1; i <= degree; ++i) {
+                long long target = (long long)address + entry.stride * (long long)i;
+                if (target >= 0) {
+                    prefetches.push_back((size_t)target);
+                }
+            }
+        }
+    }
+};
+
+// Correlation (Markov) prefetcher built on a global history buffer (GHB, address
+// correlation). Misses are appended to a circular history buffer whose entries link
+// to the previous occurrence of the same block; an index table keyed by block finds
+// the most recent occurrence. On a miss the blocks that followed earlier occurrences
+// are prefetched, up to degree of them.
+class markov_prefetcher : public prefetcher {
+public:
+    struct ghb_entry {
+        size_t block;
+        uint64_t previous; // Sequence number of the previous miss to this block, 0 if none
+    };
+
+    struct index_entry {
+        size_t block;
+        uint64_t latest;   // Sequence number of the latest miss to this block, 0 if none
+    };
+
+    size_t block_size, degree, max_chain;
+    vector<ghb_entry> ghb;        // ghb[seq % size] holds miss number seq (seq starts at 1)
+    vector<index_entry> index_table;
+    uint64_t misses_recorded;
+
+    markov_prefetcher(size_t block_size, size_t ghb_size, size_t index_size, size_t degree,
+                      size_t max_chain = 4) {
+        this->block_size = block_size;
+        this->degree = degree;
+        this->max_chain = max_chain;
+        this->ghb.resize(ghb_size, ghb_entry{0, 0});
+        this->index_table.resize(index_size, index_entry{0, 0});
+        this->misses_recorded = 0;
+    }
+
+    // A sequence number is usable while its entry has not been overwritten
+    bool in_history(uint64_t seq) {
+        return seq != 0 && seq + ghb.size() > misses_recorded;
+    }
+
+    void on_access(size_t, size_t address, bool hit, bool prefetch_hit,
+                   vector<size_t>& prefetches) override {
+        if (hit && !prefetch_hit) {
+            return;
+        }
+        size_t block = address / block_size;
+        index_entry& index = index_table[(block * 0x9E3779B97F4A7C15ULL >> 20) % index_table.size()];
+        uint64_t previous = (index.block == block && in_history(index.latest)) ? index.latest : 0;
+
+        uint64_t seq = ++misses_recorded;
+        ghb[seq % ghb.size()] = ghb_entry{block, previous};
+        index = index_entry{block, seq};
+
+        // Walk earlier occurrences, most recent first, collecting the misses that followed
+        size_t predicted = 0;
+        size_t first = prefetches.size();
+        for (size_t chain = 0; chain < max_chain && in_history(previous) && predicted < degree; ++chain) {
+            for (uint64_t next = previous + 1; next < seq && predicted < degree; ++next) {
+                size_t candidate = ghb[next % ghb.size()].block * block_size;
+                bool duplicate = candidate == block * block_size;
+                for (size_t i = first; i < prefetches.size(); ++i) {
+                    duplicate = duplicate || prefetches[i] == candidate;
+                }
+                if (!duplicate) {
+                    prefetches.push_back(candidate);
+                    predicted++;
+                }
+            }
+            previous = ghb[previous % ghb.size()].previous;
+        }
+    }
+
+    // Storage needed by the tables, assuming 48-bit physical addresses
+    size_t metadata_bytes() {
+        size_t block_bits = 48 - (size_t)log2(block_size);
+        size_t pointer_bits = (size_t)ceil(log2(ghb.size()));
+        return (ghb.size() * (block_bits + pointer_bits)
+                + index_table.size() * (block_bits + pointer_bits)) / 8;
+    }
+
+    void print_stats() {
+        cout << "Markov GHB: " << ghb.size() << " history entries, " << index_table.size()
+             << " index entries, Metadata: " << metadata_bytes() << " bytes\n";
+    }
+};
+
+// Jouppi-style stream buffers: num_buffers FIFOs of depth sequential blocks kept
+// outside the cache sets. A cache miss probes the head of every buffer in parallel;
+// a head hit moves the block into the cache without a memory read and the buffer
+// prefetches one more block to stay full. A miss in all buffers reallocates the
+// least recently used buffer to the blocks following the missing one. Prefetches
+// are block reads and go to the attached dram_model, if any.
+class stream_buffer_unit {
+public:
+    class stream_buffer {
+    public:
+        vector<size_t> blocks;   // Block start addresses, head first
+        size_t next_block;       // Next block to prefetch into the tail
+        uint64_t last_used;
+        bool allocated;
+        int hits;
+
+        stream_buffer() {
+            next_block = 0;
+            last_used = 0;
+            allocated = false;
+            hits = 0;
+        }
+    };
+
+    size_t block_size, depth;
+    size_t memory_size;
+    vector<stream_buffer> buffers;
+    dram_model* dram; // Optional DRAM timing backend receiving the prefetch reads
+    uint64_t clock;
+    int allocations, reallocations, prefetches_issued;
+
+    stream_buffer_unit(size_t block_size, size_t num_buffers, size_t depth, size_t memory_size) {
+        this->block_size = block_size;
+        this->depth = depth;
+        this->memory_size = memory_size;
+        this->buffers.resize(num_buffers);
+        this->dram = nullptr;
+        this->clock = 0;
+        reset_stats();
+    }
+
+    void reset_stats() {
+        allocations = 0;
+        reallocations = 0;
+        prefetches_issued = 0;
+        for (stream_buffer& buffer : buffers) {
+            buffer.hits = 0;
+        }
+    }
+
+    // Appends the next sequential block to a buffer if it lies inside memory
+    void refill(stream_buffer& buffer) {
+        while (buffer.blocks.size() < depth && buffer.next_block + block_size <= memory_size) {
+            buffer.blocks.push_back(buffer.next_block);
+            if (dram) {
+                dram->enqueue(buffer.next_block, false);
+            }
+            buffer.next_block += block_size;
+            prefetches_issued++;
+        }
+    }
+
+    // Probes the buffer heads for a missing block; returns true if a buffer supplies it
+    bool probe(size_t address) {
+        size_t block_start = (address / block_size) * block_size;
+        clock++;
+        for (stream_buffer& buffer : buffers) {
+            if (!buffer.blocks.empty() && buffer.blocks[0] == block_start) {
+                buffer.hits++;
+                buffer.last_used = clock;
+                buffer.blocks.erase(buffer.blocks.begin());
+                refill(buffer);
+                return true;
+            }
+        }
+
+        // Miss in every buffer: restart the least recently used one after this block
+        stream_buffer* victim = &buffers[0];
+        for (stream_buffer& buffer : buffers) {
+            if (buffer.last_used < victim->last_used) {
+                victim = &buffer;
+            }
+        }
+        if (victim->allocated) {
+            reallocations++;
+        }
+        allocations++;
+        victim->allocated = true;
+        victim->last_used = clock;
+        victim->blocks.clear();
+        victim->next_block = block_start + block_size;
+        refill(*victim);
+        return false;
+    }
+
+    void print_stats() {
+        cout << "Stream Buffers:";
+        for (size_t i = 0; i < buffers.size(); ++i) {
+            cout << " [" << i << "] Hits: " << buffers[i].hits;
+        }
+        cout << "\nAllocations: " << allocations << ", Reallocations: " << reallocations
+             << ", Blocks Prefetched: " << prefetches_issued << "\n";
+    }
+};
+
+// Common interface for the cache organizations in this file so that they can be
+// driven by the same access patterns and compared side by side
+class cache_engine {
+public:
+    size_t block_size;
+    int cache_hits, cache_misses, total_accesses;
+    map<string, double> hit_rates;
+    main_memory& memory; // Reference to main memory
+
+    cache_engine(size_t block_size, main_memory& main_mem)
+        : memory(main_mem) {
+        this->block_size = block_size;
+        this->cache_hits = 0;
+        this->cache_misses = 0;
+        this->total_accesses = 0;
+    }
+
+    virtual ~cache_engine() {}
+
+    // Reads one byte through the cache, filling from main memory on a miss
+    virtual uint8_t read_from_cache(size_t address) = 0;
+
+    virtual void reset_cache_stats() {
+        cache_hits = 0;
+        cache_misses = 0;
+    }
+
+    // Prints cache performance statistics
+    virtual void print_cache_stats(const string& pattern) {
+        double hit_rate = (cache_hits * 100.0) / (cache_hits + cache_misses);
+        hit_rates[pattern] = hit_rate;
+        cout << "\nCache Stats for " << pattern << ": "
+             << "Hits: " << cache_hits << ", Misses: " << cache_misses
+             << ", Hit Rate: " << hit_rate << "%\n";
+    }
+};
+
+// Implements a 4-way set-associative cache with PLRU replacement policy
+class set_associative_cache : public cache_engine {
+public:
+    size_t num_sets;
+    vector<cache_set> sets;
+    write_hit_policy hit_policy;
+    write_miss_policy miss_policy;
+    int writebacks;
+    size_t writeback_bytes;      // Dirty blocks written to memory on eviction
+    size_t write_through_bytes;  // Stores forwarded to memory (write-through or no-allocate)
+    write_buffer* write_buf;     // Optional coalescing buffer in front of main memory
+    dram_model* dram;            // Optional DRAM timing backend fed with fills and writes
+    pmem_tracker* pmem;          // Optional accounting of writes to persistent memory
+    address_translator* translator;  // Optional virtual-to-physical mapping applied before indexing
+    bool tag_only;               // Lower hierarchy levels track tags and dirty state only
+    bool last_access_hit;        // Outcome of the most recent read or write
+    bool last_evicted_valid, last_evicted_dirty;  // Line displaced by the most recent fill
+    size_t last_evicted_address;
+
+    // A prefetch issued at access N becomes a line before access N + 1 + prefetch_latency
+    struct pending_prefetch {
+        size_t block_start;
+        uint64_t ready_at;
+    };
+
+    prefetcher* pf;              // Optional prefetcher trained on demand accesses
+    size_t prefetch_latency;
+    vector<pending_prefetch> in_flight_prefetches;
+    vector<size_t> prefetch_candidates;
+    vector<size_t> due_prefetches;            // Scratch list for complete_prefetches()
+    unordered_set<size_t> prefetch_evicted;  // Blocks displaced by prefetch fills
+    bool last_prefetch_hit;
+    stream_buffer_unit* stream_bufs;  // Optional stream buffers probed on misses
+    bool last_stream_hit;             // The last lookup missed but a stream buffer held the block
+    int stream_buffer_hits;           // Hits served by a stream buffer head (included in cache_hits)
+    int prefetches_issued, useful_prefetches, late_prefetches, useless_prefetches, pollution_misses;
+    int low_priority_fills;     // Fills inserted at the LRU position (evict-first hints)
+    int non_temporal_bypasses;  // Non-temporal stores sent to memory without allocating
+    int software_prefetches;    // Prefetch-only records that filled a block
+    int bypassed_fills;         // Misses not filled because every way of the set was locked
+    int locked_set_misses;      // Demand misses in sets with at least one locked way
+    int multi_byte_accesses;    // read()/write() calls and records of more than one byte
+    int split_accesses;         // Multi-byte accesses that span two blocks
+    vector<uint8_t> record_bytes;  // Data of the record being performed by access()
+    int flushed_lines, cleaned_lines, invalidated_lines;  // Lines affected by maintenance operations
+    int discarded_dirty_lines;  // Dirty lines dropped by invalidation without a writeback
+    int maintenance_set_walks;  // Range operations done by walking every line instead of probing
+    int coherence_invalidations, coherence_downgrades;  // Lines invalidated or written back by coherence probes
+    asid_mode asid_policy;
+    uint16_t current_asid;      // Address space of the running process
+    size_t asid_region;         // Bytes of main memory backing each address space; 0 shares one memory
+    uint32_t epoch;             // Bumped by each flush-on-switch; lines of older epochs are invalid
+    int context_switches;
+    int cross_process_evictions;  // Fills that displaced a live line of another address space
+    int stale_writebacks;       // Dirty lines of a flushed epoch written back when reclaimed
+    vector<int> asid_hits, asid_misses;  // Demand hits and misses per address space
+    
+    set_associative_cache(size_t block_size, size_t cache_size, main_memory& main_mem,
+                          write_hit_policy hit_policy = WRITE_BACK,
+                          write_miss_policy miss_policy = WRITE_ALLOCATE)
+        : cache_engine(block_size, main_mem) {
+        this->num_sets = cache_size / (NUM_WAYS * block_size);
+        this->sets.resize(num_sets, cache_set(block_size));
+        this->hit_policy = hit_policy;
+        this->miss_policy = miss_policy;
+        this->writebacks = 0;
+        this->writeback_bytes = 0;
+        this->write_through_bytes = 0;
+        this->write_buf = nullptr;
+        this->dram = nullptr;
+        this->pmem = nullptr;
+        this->translator = nullptr;
+        this->tag_only = false;
+        this->last_access_hit = false;
+        this->last_evicted_valid = false;
+        this->last_evicted_dirty = false;
+        this->last_evicted_address = 0;
+        this->pf = nullptr;
+        this->prefetch_latency = 0;
+        this->last_prefetch_hit = false;
+        this->stream_bufs = nullptr;
+        this->last_stream_hit = false;
+        this->stream_buffer_hits = 0;
+        this->prefetches_issued = 0;
+        this->useful_prefetches = 0;
+        this->late_prefetches = 0;
+        this->useless_prefetches = 0;
+        this->pollution_misses = 0;
+        this->low_priority_fills = 0;
+        this->non_temporal_bypasses = 0;
+        this->software_prefetches = 0;
+        this->bypassed_fills = 0;
+        this->locked_set_misses = 0;
+        this->multi_byte_accesses = 0;
+        this->split_accesses = 0;
+        this->flushed_lines = 0;
+        this->cleaned_lines = 0;
+        this->invalidated_lines = 0;
+        this->discarded_dirty_lines = 0;
+        this->maintenance_set_walks = 0;
+        this->coherence_invalidations = 0;
+        this->coherence_downgrades = 0;
+        this->asid_policy = ASID_NONE;
+        this->current_asid = 0;
+        this->asid_region = 0;
+        this->epoch = 0;
+        this->context_switches = 0;
+        this->cross_process_evictions = 0;
+        this->stale_writebacks = 0;
+    }
+
+    void reset_cache_stats() override {
+        cache_engine::reset_cache_stats();
+        writebacks = 0;
+        writeback_bytes = 0;
+        write_through_bytes = 0;
+        prefetches_issued = 0;
+        useful_prefetches = 0;
+        late_prefetches = 0;
+        useless_prefetches = 0;
+        pollution_misses = 0;
+        stream_buffer_hits = 0;
+        low_priority_fills = 0;
+        non_temporal_bypasses = 0;
+        software_prefetches = 0;
+        bypassed_fills = 0;
+        locked_set_misses = 0;
+        multi_byte_accesses = 0;
+        split_accesses = 0;
+        flushed_lines = 0;
+        cleaned_lines = 0;
+        invalidated_lines = 0;
+        discarded_dirty_lines = 0;
+        maintenance_set_walks = 0;
+        coherence_invalidations = 0;
+        coherence_downgrades = 0;
+        context_switches = 0;
+        cross_process_evictions = 0;
+        stale_writebacks = 0;
+        asid_hits.clear();
+        asid_misses.clear();
+    }
+
+    // Extracts the tag from the given memory address
+    size_t extract_tag(size_t address) {
+        return address / (block_size * num_sets);
+    }
+
+    // Extracts the index (set number) from the given memory address
+    size_t extract_index(size_t address) {
+        return (address >> (size_t)log2(block_size)) % num_sets;
+    }
+
+    // Extracts the block offset from the given memory address
+    size_t extract_block_offset(size_t address) {
+        return address % block_size;
+    }
+
+    // Rebuilds the start address of the block held by a line
+    size_t block_address(size_t set_idx, int way) {
+        return (sets[set_idx].lines[way].tag * num_sets + set_idx) * block_size;
+    }
+
+    // True if the line holds a block visible to the running process: valid, of the
+    // current epoch, and in ASID-tagged mode filled by the current address space
+    bool line_live(const cache_line& line) {
+        return line.valid && line.epoch == epoch && (asid_policy != ASID_TAGGED || line.asid == current_asid);
+    }
+
+    // Returns the way holding the tag in the given set, or -1 on a miss
+    int find_way(size_t set_idx, size_t tag) {
+        for (int i = 0; i < NUM_WAYS; ++i) {
+            if (sets[set_idx].lines[i].tag == tag && line_live(sets[set_idx].lines[i])) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // Unlocks the ways of a set whose line belongs to a flushed epoch: the lock went
+    // with the flushed block. Reserved ways that are still empty stay locked.
+    void drop_stale_locks(size_t set_idx) {
+        cache_set& set = sets[set_idx];
+        for (int i = 0; i < NUM_WAYS && set.locked_ways; ++i) {
+            if (set.lines[i].valid && set.lines[i].epoch != epoch) {
+                set.locked_ways &= ~(1 << i);
+            }
+        }
+    }
+
+    // Picks the way to fill: an empty unlocked line if there is one, otherwise the
+    // PLRU victim; -1 if every way of the set is locked. Lines of a flushed epoch
+    // count as empty.
+    int find_victim_way(size_t set_idx) {
+        drop_stale_locks(set_idx);
+        for (int i = 0; i < NUM_WAYS; ++i) {
+            const cache_line& line = sets[set_idx].lines[i];
+            if ((!line.valid || line.epoch != epoch) && !(sets[set_idx].locked_ways & (1 << i))) {
+                return i;
+            }
+        }
+        return sets[set_idx].findPLRUVictim();
+    }
+
+    // Switches to another address space. Flush-on-switch invalidates the whole cache
+    // in O(1) by starting a new epoch; stale lines are reclaimed lazily as fills reuse
+    // them, and a dirty one is written back then. Their locks lapse the same way.
+    void context_switch(uint16_t asid) {
+        if (asid == current_asid) {
+            return;
+        }
+        context_switches++;
+        current_asid = asid;
+        if (asid_policy == ASID_FLUSH_ON_SWITCH) {
+            epoch++;
+        }
+    }
+
+    // Main-memory address backing address in the given address space. With an
+    // asid_region, ASID a owns [a * asid_region, (a + 1) * asid_region), so processes
+    // using the same virtual addresses keep separate data.
+    size_t backing_address(size_t address, uint16_t asid) {
+        assert(!asid_region || address < asid_region);
+        return asid * asid_region + address;
+    }
+
+    // Drops other copies of a block about to be filled that share its backing memory:
+    // a line of a flushed epoch, or without an asid_region a line of another address
+    // space. Only a single copy of each backed block may stay cached.
+    void drop_aliases(size_t set_idx, size_t tag, int way) {
+        for (int i = 0; i < NUM_WAYS; ++i) {
+            cache_line& line = sets[set_idx].lines[i];
+            if (i == way || !line.valid || line.tag != tag || (asid_region && line.asid != current_asid)) {
+                continue;
+            }
+            count_reclaimed_line(line);
+            write_back_line(set_idx, i);
+            line.valid = false;
+            line.prefetched = false;
+        }
+    }
+
+    // Counts a line being replaced that belongs to another address space or epoch
+    void count_reclaimed_line(const cache_line& line) {
+        if (!line.valid) {
+            return;
+        }
+        if (line.epoch != epoch) {
+            stale_writebacks += line.dirty;
+        } else if (line.asid != current_asid) {
+            cross_process_evictions++;
+        }
+    }
+
+    // Sends len bytes (within one block) to main memory, through the write buffer if present
+    void write_to_memory(size_t address, const uint8_t* src, size_t len, persist_cause cause = PERSIST_STORE) {
+        if (pmem) {
+            pmem->on_write(address, len, cause);
+        }
+        if (write_buf) {
+            write_buf->write(address, src, len);
+        } else {
+            memcpy(&memory.memory_array[address], src, len);
+            if (dram) {
+                dram->enqueue((address / block_size) * block_size, true);
+            }
+        }
+    }
+
+    // Writes a dirty line back to main memory and marks it clean
+    void write_back_line(size_t set_idx, int way, persist_cause cause = PERSIST_EVICTION) {
+        cache_line& line = sets[set_idx].lines[way];
+        if (!line.valid || !line.dirty) {
+            return;
+        }
+        size_t address = backing_address(block_address(set_idx, way), line.asid);
+        write_to_memory(address, line.cache_data.data(), block_size, cause);
+        line.dirty = false;
+        writebacks++;
+        writeback_bytes += block_size;
+    }
+
+    // Remembers the line about to be replaced so that callers can act on the victim
+    void record_eviction(size_t set_idx, int way) {
+        cache_line& line = sets[set_idx].lines[way];
+        last_evicted_valid = line.valid;
+        last_evicted_dirty = line.valid && line.dirty;
+        last_evicted_address = line.valid ? block_address(set_idx, way) : 0;
+    }
+
+    // Loads a memory block into the cache, writing back the evicted line if dirty.
+    // read_memory is false when a stream buffer already fetched the block.
+    void load_block_from_memory(size_t address, int way, bool read_memory = true) {
+        size_t set_idx = extract_index(address);
+        size_t tag = extract_tag(address);
+        size_t block_start = backing_address((address / block_size) * block_size, current_asid);
+        assert(block_start + block_size <= memory.memory_array.size());
+        
+        if (asid_policy != ASID_NONE) {
+            drop_aliases(set_idx, tag, way);
+            count_reclaimed_line(sets[set_idx].lines[way]);
+        }
+        record_eviction(set_idx, way);
+        write_back_line(set_idx, way);
+        if (sets[set_idx].lines[way].valid && sets[set_idx].lines[way].prefetched) {
+            useless_prefetches++;
+        }
+        sets[set_idx].lines[way].prefetched = false;
+        if (write_buf) {
+            write_buf->stall_load(block_start);
+        }
+        if (dram && read_memory) {
+            dram->enqueue(block_start, false);
+        }
+        sets[set_idx].lines[way].valid = true;
+        sets[set_idx].lines[way].tag = tag;
+        sets[set_idx].lines[way].asid = current_asid;
+        sets[set_idx].lines[way].epoch = epoch;
+        for (size_t i = 0; i < block_size; i++) {
+            sets[set_idx].lines[way].cache_data[i] = memory.memory_array[block_start + i];
+        }
+    }
+
+    // Preloads blocks into the cache to prevent cold misses
+    void preload_cache(size_t start_address, size_t num_blocks) {
+        for (size_t i = 0; i < num_blocks; ++i) {
+            size_t address = start_address + i * block_size;
+            size_t set_idx = extract_index(address);
+            int evictWay = find_victim_way(set_idx);
+            if (evictWay == -1) {
+                continue;
+            }
+
+            load_block_from_memory(address, evictWay);
+            sets[set_idx].updatePLRU(evictWay);
+        }
+    }
+
+    // Fills a prefetched block as the most recently used line of its set; returns
+    // false if the block is already cached or every way of its set is locked.
+    // displaced and victim report the block the fill evicted.
+    bool prefetch_fill(size_t block_start, bool& displaced, size_t& victim) {
+        size_t set_idx = extract_index(block_start);
+        displaced = false;
+        if (find_way(set_idx, extract_tag(block_start)) != -1) {
+            return false;
+        }
+        int way = find_victim_way(set_idx);
+        if (way == -1) {
+            return false;
+        }
+
+        // Prefetch fills are not part of the demand access being processed
+        bool saved_valid = last_evicted_valid, saved_dirty = last_evicted_dirty;
+        size_t saved_address = last_evicted_address;
+        load_block_from_memory(block_start, way);
+        sets[set_idx].lines[way].prefetched = true;
+        sets[set_idx].updatePLRU(way);
+        if (last_evicted_valid) {
+            prefetch_evicted.insert(last_evicted_address);
+            displaced = true;
+            victim = last_evicted_address;
+        }
+        last_evicted_valid = saved_valid;
+        last_evicted_dirty = saved_dirty;
+        last_evicted_address = saved_address;
+        return true;
+    }
+
+    // Moves the in-flight prefetches whose latency has elapsed by access number now
+    // to due, oldest first
+    void take_due_prefetches(vector<size_t>& due, uint64_t now) {
+        size_t kept = 0;
+        for (size_t i = 0; i < in_flight_prefetches.size(); ++i) {
+            if (in_flight_prefetches[i].ready_at < now) {
+                due.push_back(in_flight_prefetches[i].block_start);
+            } else {
+                in_flight_prefetches[kept++] = in_flight_prefetches[i];
+            }
+        }
+        in_flight_prefetches.resize(kept);
+    }
+
+    // Installs every in-flight prefetch whose latency has elapsed
+    void complete_prefetches() {
+        due_prefetches.clear();
+        take_due_prefetches(due_prefetches, total_accesses);
+        for (size_t block_start : due_prefetches) {
+            bool displaced;
+            size_t victim;
+            prefetch_fill(block_start, displaced, victim);
+        }
+    }
+
+    // A demand miss on an in-flight prefetch is late; one on a block displaced by a
+    // prefetch fill is a pollution miss
+    void note_demand_miss(size_t address) {
+        size_t block_start = (address / block_size) * block_size;
+        for (size_t i = 0; i < in_flight_prefetches.size(); ++i) {
+            if (in_flight_prefetches[i].block_start == block_start) {
+                late_prefetches++;
+                in_flight_prefetches.erase(in_flight_prefetches.begin() + i);
+                break;
+            }
+        }
+        if (prefetch_evicted.erase(block_start)) {
+            pollution_misses++;
+        }
+    }
+
+    // Trains the prefetcher on the last demand access and queues its new predictions
+    void issue_prefetches(size_t pc, size_t address) {
+        prefetch_candidates.clear();
+        pf->on_access(pc, address, last_access_hit, last_prefetch_hit, prefetch_candidates);
+        for (size_t target : prefetch_candidates) {
+            size_t block_start = (target / block_size) * block_size;
+            if (block_start + block_size > memory.size ||
+                find_way(extract_index(block_start), extract_tag(block_start)) != -1) {
+                continue;
+            }
+            bool pending = false;
+            for (const pending_prefetch& p : in_flight_prefetches) {
+                pending = pending || p.block_start == block_start;
+            }
+            if (!pending) {
+                prefetches_issued++;
+                in_flight_prefetches.push_back({block_start, (uint64_t)total_accesses + prefetch_latency});
+            }
+        }
+    }
+
+    // Bookkeeping shared by every demand access before its lookup
+    void begin_access() {
+        total_accesses++;
+        last_evicted_valid = false;
+        if (write_buf) {
+            write_buf->tick();
+        }
+        if (pf) {
+            complete_prefetches();
+        }
+    }
+
+    // Looks up a demand access and updates the hit, miss and prefetch counters. A
+    // miss that will fill the block probes the stream buffers first; a head hit
+    // counts as a hit served by the buffer, and the fill then reads no memory.
+    int demand_lookup(size_t address, bool fill_on_miss = true) {
+        size_t set_idx = extract_index(address);
+        int way = find_way(set_idx, extract_tag(address));
+        last_access_hit = way != -1;
+        last_prefetch_hit = false;
+        last_stream_hit = way == -1 && fill_on_miss && stream_bufs && stream_bufs->probe(address);
+        if (asid_policy != ASID_NONE) {
+            if (asid_hits.size() <= current_asid) {
+                asid_hits.resize(current_asid + 1, 0);
+                asid_misses.resize(current_asid + 1, 0);
+            }
+            (way != -1 || last_stream_hit ? asid_hits : asid_misses)[current_asid]++;
+        }
+        if (way != -1) {
+            cache_hits++;
+            cache_line& line = sets[set_idx].lines[way];
+            if (line.prefetched) {
+                line.prefetched = false;
+                last_prefetch_hit = true;
+                useful_prefetches++;
+            }
+        } else {
+            if (last_stream_hit) {
+                cache_hits++;
+                stream_buffer_hits++;
+            } else {
+                cache_misses++;
+            }
+            if (asid_policy != ASID_NONE) {
+                // Misses that bypass the cache must not leave another copy behind
+                drop_aliases(set_idx, extract_tag(address), -1);
+            }
+            drop_stale_locks(set_idx);
+            if (sets[set_idx].locked_ways) {
+                locked_set_misses++;
+            }
+            if (pf) {
+                note_demand_miss(address);
+            }
+        }
+        return way;
+    }
+
+    // Fills the block of a demand miss, from a stream buffer if one held it, and
+    // returns the way it was placed in, or -1 if every way of the set is locked and
+    // the access bypasses the cache
+    int fill_demand_miss(size_t address) {
+        size_t set_idx = extract_index(address);
+        int way = find_victim_way(set_idx);
+        if (way == -1) {
+            bypassed_fills++;
+            return -1;
+        }
+        load_block_from_memory(address, way, !last_stream_hit);
+        return way;
+    }
+
+    // Reads data from the cache and applies PLRU replacement if needed
+    uint8_t read_from_cache(size_t address) override {
+        return read_from_cache(address, 0);
+    }
+
+    // Reads data on behalf of the instruction at pc (used by PC-indexed prefetchers)
+    uint8_t read_from_cache(size_t address, size_t pc) {
+        if (translator) {
+            address = translator->translate(address);
+        }
+        uint8_t value;
+        read_physical(address, 1, &value, pc, false);
+        return value;
+    }
+
+    // Reads len bytes starting at address into dst. An access that spans two blocks
+    // takes one lookup per block and is counted as a split access.
+    void read(size_t address, size_t len, uint8_t* dst, size_t pc = 0) {
+        count_multi_byte(address, len);
+        while (len > 0) {
+            size_t chunk = min(len, block_size - address % block_size);
+            read_physical(translator ? translator->translate(address) : address, chunk, dst, pc, false);
+            address += chunk;
+            dst += chunk;
+            len -= chunk;
+        }
+    }
+
+    // Writes len bytes from src starting at address, one lookup per block touched
+    void write(size_t address, size_t len, const uint8_t* src, size_t pc = 0) {
+        count_multi_byte(address, len);
+        while (len > 0) {
+            size_t chunk = min(len, block_size - address % block_size);
+            write_physical(translator ? translator->translate(address) : address, chunk, src, pc,
+                           miss_policy == WRITE_ALLOCATE, false);
+            address += chunk;
+            src += chunk;
+            len -= chunk;
+        }
+    }
+
+    // Counts a multi-byte access, and whether it spans two blocks
+    void count_multi_byte(size_t address, size_t len) {
+        if (len > 1) {
+            multi_byte_accesses++;
+        }
+        if (address % block_size + len > block_size) {
+            split_accesses++;
+        }
+    }
+
+    // Marks a freshly filled way most recently used, or least recently used for a
+    // low-priority fill
+    void place_fill(size_t set_idx, int way, bool low_priority) {
+        if (low_priority) {
+            sets[set_idx].demotePLRU(way);
+            low_priority_fills++;
+        } else {
+            sets[set_idx].updatePLRU(way);
+        }
+    }
+
+    // Read path after address translation for len bytes within one block
+    void read_physical(size_t address, size_t len, uint8_t* dst, size_t pc, bool low_priority) {
+        size_t set_idx = extract_index(address);
+        size_t block_offset = extract_block_offset(address);
+
+        begin_access();
+        int way = demand_lookup(address);
+        if (way == -1) {
+            // Cache miss: find a victim and load block from memory
+            way = fill_demand_miss(address);
+            if (way == -1) {
+                // Every way is locked: read memory directly, after any buffered
+                // stores to the block have drained
+                size_t backing = backing_address(address, current_asid);
+                if (write_buf) {
+                    write_buf->stall_load(backing);
+                }
+                if (dram && !last_stream_hit) {
+                    dram->enqueue((backing / block_size) * block_size, false);
+                }
+                memcpy(dst, &memory.memory_array[backing], len);
+                if (pf) {
+                    issue_prefetches(pc, address);
+                }
+                return;
+            }
+            place_fill(set_idx, way, low_priority);
+        } else {
+            sets[set_idx].updatePLRU(way);
+        }
+        memcpy(dst, &sets[set_idx].lines[way].cache_data[block_offset], len);
+        if (pf) {
+            issue_prefetches(pc, address);
+        }
+    }
+
+    // Writes one byte, following the configured write-hit and write-miss policies
+    void write_to_cache(size_t address, uint8_t value, size_t pc = 0) {
+        if (translator) {
+            address = translator->translate(address);
+        }
+        write_physical(address, 1, &value, pc, miss_policy == WRITE_ALLOCATE, false);
+    }
+
+    // Write path after address translation for len bytes within one block; a miss
+    // allocates only if allocate is set
+    void write_physical(size_t address, size_t len, const uint8_t* src, size_t pc, bool allocate,
+                        bool low_priority) {
+        size_t set_idx = extract_index(address);
+        size_t block_offset = extract_block_offset(address);
+
+        begin_access();
+        int way = demand_lookup(address, allocate);
+        bool filled = way == -1;
+        if (way == -1) {
+            if (allocate) {
+                way = fill_demand_miss(address);
+            }
+            if (way == -1) {
+                // The store goes straight to memory and the cache is left untouched
+                write_to_memory(backing_address(address, current_asid), src, len);
+                write_through_bytes += len;
+                if (pf) {
+                    issue_prefetches(pc, address);
+                }
+                return;
+            }
+        }
+
+        cache_line& line = sets[set_idx].lines[way];
+        memcpy(&line.cache_data[block_offset], src, len);
+        if (hit_policy == WRITE_THROUGH) {
+            write_to_memory(backing_address(address, current_asid), src, len);
+            write_through_bytes += len;
+        } else {
+            line.dirty = true;
+        }
+        if (filled) {
+            place_fill(set_idx, way, low_priority);
+        } else {
+            sets[set_idx].updatePLRU(way);
+        }
+        if (pf) {
+            issue_prefetches(pc, address);
+        }
+    }
+
+    // Brings a block into the cache without a demand access (a software prefetch)
+    void software_prefetch(size_t address) {
+        size_t set_idx = extract_index(address);
+        last_evicted_valid = false;
+        int way = find_way(set_idx, extract_tag(address));
+        if (way == -1) {
+            way = find_victim_way(set_idx);
+            if (way == -1) {
+                return;
+            }
+            load_block_from_memory(address, way);
+            software_prefetches++;
+        }
+        sets[set_idx].updatePLRU(way);
+    }
+
+    // Locks a block into the cache, filling it first if needed, so that it is never
+    // replaced; an empty reserved way is used before an unlocked one. Returns false
+    // if the block is not cached and every way of its set is locked.
+    bool lock_block(size_t address) {
+        if (translator) {
+            address = translator->translate(address);
+        }
+        size_t set_idx = extract_index(address);
+        cache_set& set = sets[set_idx];
+        int way = find_way(set_idx, extract_tag(address));
+        drop_stale_locks(set_idx);
+        if (way == -1) {
+            for (int i = 0; i < NUM_WAYS && way == -1; ++i) {
+                if ((set.locked_ways & (1 << i)) && !set.lines[i].valid) {
+                    way = i;
+                }
+            }
+            if (way == -1) {
+                way = find_victim_way(set_idx);
+            }
+            if (way == -1) {
+                return false;
+            }
+            last_evicted_valid = false;
+            load_block_from_memory(address, way);
+        }
+        set.locked_ways |= 1 << way;
+        set.updatePLRU(way);
+        return true;
+    }
+
+    // Returns a locked block to normal replacement; false if it is not cached
+    bool unlock_block(size_t address) {
+        if (translator && !translator->lookup(address, address)) {
+            return false;
+        }
+        size_t set_idx = extract_index(address);
+        int way = find_way(set_idx, extract_tag(address));
+        if (way == -1) {
+            return false;
+        }
+        sets[set_idx].locked_ways &= ~(1 << way);
+        return true;
+    }
+
+    // Reserves the ways in way_mask of sets [first_set, first_set + count), e.g. for
+    // cache-as-RAM. Their current blocks are written back and invalidated, and the
+    // ways are then filled only by lock_block().
+    void reserve_ways(size_t first_set, size_t count, uint8_t way_mask) {
+        way_mask &= (1 << NUM_WAYS) - 1;
+        for (size_t set_idx = first_set; set_idx < first_set + count && set_idx < num_sets; ++set_idx) {
+            drop_stale_locks(set_idx);
+            for (int way = 0; way < NUM_WAYS; ++way) {
+                if ((way_mask & (1 << way)) && !(sets[set_idx].locked_ways & (1 << way))) {
+                    write_back_line(set_idx, way);
+                    sets[set_idx].lines[way].valid = false;
+                    sets[set_idx].lines[way].prefetched = false;
+                }
+            }
+            sets[set_idx].locked_ways |= way_mask;
+        }
+    }
+
+    // Releases reserved or locked ways; their blocks stay cached but become replaceable
+    void release_ways(size_t first_set, size_t count, uint8_t way_mask) {
+        for (size_t set_idx = first_set; set_idx < first_set + count && set_idx < num_sets; ++set_idx) {
+            sets[set_idx].locked_ways &= ~way_mask;
+        }
+    }
+
+    // Performs one trace record of record.size bytes (stores write record.value to
+    // each byte), applying its access hint: non-temporal loads fill at the LRU
+    // position and non-temporal stores that miss bypass the cache through the write
+    // path, evict-first accesses fill at the LRU position, and prefetch-only records
+    // fill without counting as demand accesses
+    void access(const trace_record& record, size_t pc = 0) {
+        size_t address = record.address;
+        size_t len = max((size_t)record.size, (size_t)1);
+        if (is_maintenance(record.type)) {
+            maintain_range(record.type, address, len);
+            return;
+        }
+        if (record.type == ACCESS_FENCE) {
+            if (pmem) {
+                pmem->fence();
+            }
+            return;
+        }
+        if (record.type == ACCESS_CONTEXT_SWITCH) {
+            context_switch(record.asid);
+            return;
+        }
+        record_bytes.assign(len, record.value);
+        bool low_priority = record.hint == HINT_NON_TEMPORAL || record.hint == HINT_EVICT_FIRST;
+        if (record.hint != HINT_PREFETCH_ONLY) {
+            count_multi_byte(address, len);
+        }
+        for (size_t done = 0; done < len;) {
+            size_t chunk = min(len - done, block_size - address % block_size);
+            size_t physical = translator ? translator->translate(address) : address;
+            if (record.hint == HINT_PREFETCH_ONLY) {
+                software_prefetch(physical);
+            } else if (record.type != ACCESS_WRITE) {
+                read_physical(physical, chunk, &record_bytes[done], pc, low_priority);
+            } else if (record.hint == HINT_NON_TEMPORAL) {
+                write_physical(physical, chunk, &record_bytes[done], pc, false, true);
+                if (!last_access_hit) {
+                    non_temporal_bypasses++;
+                }
+            } else {
+                write_physical(physical, chunk, &record_bytes[done], pc, miss_policy == WRITE_ALLOCATE, low_priority);
+            }
+            address += chunk;
+            done += chunk;
+        }
+    }
+
+    // Tag-only lookup used by cache_hierarchy; updates PLRU state on a hit
+    int probe_block(size_t address) {
+        size_t set_idx = extract_index(address);
+        int way = find_way(set_idx, extract_tag(address));
+        if (way != -1) {
+            sets[set_idx].updatePLRU(way);
+        }
+        return way;
+    }
+
+    // Marks a resident block dirty; returns false if the block is not cached
+    bool mark_dirty(size_t address) {
+        size_t set_idx = extract_index(address);
+        int way = find_way(set_idx, extract_tag(address));
+        if (way == -1) {
+            return false;
+        }
+        sets[set_idx].lines[way].dirty = true;
+        return true;
+    }
+
+    // Tag-only fill used by cache_hierarchy. The victim is recorded in last_evicted_*
+    // and left to the caller instead of being written back to memory.
+    void insert_block(size_t address, bool dirty) {
+        size_t set_idx = extract_index(address);
+        int way = find_victim_way(set_idx);
+        if (way == -1) {
+            // Every way is locked: the block passes straight through as the victim
+            last_evicted_valid = true;
+            last_evicted_dirty = dirty;
+            last_evicted_address = (address / block_size) * block_size;
+            return;
+        }
+        record_eviction(set_idx, way);
+        sets[set_idx].lines[way].valid = true;
+        sets[set_idx].lines[way].dirty = dirty;
+        sets[set_idx].lines[way].tag = extract_tag(address);
+        sets[set_idx].lines[way].asid = current_asid;
+        sets[set_idx].lines[way].epoch = epoch;
+        sets[set_idx].updatePLRU(way);
+    }
+
+    // Applies a maintenance operation to one resident line: flush writes it back if
+    // dirty and invalidates it, clean only writes it back, and invalidate drops it
+    // without writing it back. Locked ways stay locked.
+    void maintain_line(access_type op, size_t set_idx, int way) {
+        cache_line& line = sets[set_idx].lines[way];
+        if (op == ACCESS_CLEAN) {
+            cleaned_lines += line.dirty;
+            if (!tag_only) {
+                write_back_line(set_idx, way, PERSIST_EXPLICIT);
+            }
+            line.dirty = false;
+            return;
+        }
+        if (op == ACCESS_FLUSH) {
+            flushed_lines++;
+            if (!tag_only) {
+                write_back_line(set_idx, way, PERSIST_EXPLICIT);
+            }
+        } else {
+            invalidated_lines++;
+            discarded_dirty_lines += line.dirty;
+        }
+        line.valid = false;
+        line.dirty = false;
+        line.prefetched = false;
+    }
+
+    // Coherence probe that takes the block of address away: a dirty copy is written
+    // back like an eviction, not as an explicit flush. Returns whether it was cached.
+    bool coherence_invalidate(size_t address) {
+        size_t set_idx = extract_index(address);
+        int way = find_way(set_idx, extract_tag(address));
+        if (way == -1) {
+            return false;
+        }
+        cache_line& line = sets[set_idx].lines[way];
+        if (!tag_only) {
+            write_back_line(set_idx, way);
+        }
+        line.valid = false;
+        line.dirty = false;
+        line.prefetched = false;
+        coherence_invalidations++;
+        return true;
+    }
+
+    // Coherence probe for a read by another core: a dirty copy of the block of
+    // address is written back and kept clean. Returns whether it was dirty.
+    bool coherence_downgrade(size_t address) {
+        size_t set_idx = extract_index(address);
+        int way = find_way(set_idx, extract_tag(address));
+        if (way == -1 || !sets[set_idx].lines[way].dirty) {
+            return false;
+        }
+        if (!tag_only) {
+            write_back_line(set_idx, way);
+        }
+        sets[set_idx].lines[way].dirty = false;
+        coherence_downgrades++;
+        return true;
+    }
+
+    // Applies a maintenance operation to the block holding a physical address;
+    // returns whether the block was cached
+    bool maintain_block(access_type op, size_t address) {
+        size_t set_idx = extract_index(address);
+        int way = find_way(set_idx, extract_tag(address));
+        if (way == -1) {
+            return false;
+        }
+        maintain_line(op, set_idx, way);
+        return true;
+    }
+
+    // Applies a maintenance operation to every cached block of [address, address + len).
+    // A physical range with more blocks than the cache has lines is handled by walking
+    // every line once and testing its block address against the range. A virtual
+    // range is looked up page by page without mapping new pages.
+    void maintain_range(access_type op, size_t address, size_t len) {
+        size_t first_block = address / block_size, end_block = (address + len + block_size - 1) / block_size;
+        if (!translator && end_block - first_block > num_sets * NUM_WAYS) {
+            maintenance_set_walks++;
+            for (size_t set_idx = 0; set_idx < num_sets; ++set_idx) {
+                for (int way = 0; way < NUM_WAYS; ++way) {
+                    size_t block = block_address(set_idx, way) / block_size;
+                    if (line_live(sets[set_idx].lines[way]) && block >= first_block && block < end_block) {
+                        maintain_line(op, set_idx, way);
+                    }
+                }
+            }
+            return;
+        }
+        for (size_t block = first_block; block < end_block; ++block) {
+            size_t block_start = block * block_size;
+            size_t physical = block_start;
+            if (translator && !translator->lookup(block_start, physical)) {
+                // A page that was never mapped has nothing cached: skip the rest of it
+                block = (block_start / translator->page_size + 1) * translator->page_size / block_size - 1;
+                continue;
+            }
+            maintain_block(op, physical);
+        }
+    }
+
+    // clflush: writes back the block of address if it is dirty and invalidates it
+    void flush_block(size_t address) {
+        maintain_range(ACCESS_FLUSH, address, 1);
+    }
+
+    // clwb: writes back the block of address if it is dirty and keeps it cached
+    void clean_block(size_t address) {
+        maintain_range(ACCESS_CLEAN, address, 1);
+    }
+
+    // Drops the block of address without writing it back (dirty data is lost)
+    void invalidate_block(size_t address) {
+        maintain_range(ACCESS_INVALIDATE, address, 1);
+    }
+
+    void flush_range(size_t address, size_t len) {
+        maintain_range(ACCESS_FLUSH, address, len);
+    }
+
+    void clean_range(size_t address, size_t len) {
+        maintain_range(ACCESS_CLEAN, address, len);
+    }
+
+    void invalidate_range(size_t address, size_t len) {
+        maintain_range(ACCESS_INVALIDATE, address, len);
+    }
+
+    // wbinvd: writes back every dirty line and empties the cache
+    void flush_all() {
+        for (size_t set_idx = 0; set_idx < num_sets; ++set_idx) {
+            for (int way = 0; way < NUM_WAYS; ++way) {
+                if (sets[set_idx].lines[way].valid) {
+                    maintain_line(ACCESS_FLUSH, set_idx, way);
+                }
+            }
+        }
+    }
+
+    // invd: empties the cache without writing anything back
+    void invalidate_all() {
+        for (size_t set_idx = 0; set_idx < num_sets; ++set_idx) {
+            for (int way = 0; way < NUM_WAYS; ++way) {
+                if (sets[set_idx].lines[way].valid) {
+                    maintain_line(ACCESS_INVALIDATE, set_idx, way);
+                }
+            }
+        }
+    }
+
+    // Invalidates a block if it is cached; returns whether it was present. Dirty data
+    // of a data-holding cache is written back to memory first.
+    bool drop_block(size_t address, bool& was_dirty) {
+        size_t set_idx = extract_index(address);
+        int way = find_way(set_idx, extract_tag(address));
+        was_dirty = false;
+        if (way == -1) {
+            return false;
+        }
+        was_dirty = sets[set_idx].lines[way].dirty;
+        if (!tag_only) {
+            write_back_line(set_idx, way);
+        }
+        sets[set_idx].lines[way].valid = false;
+        sets[set_idx].lines[way].dirty = false;
+        return true;
+    }
+
+    void print_cache_stats(const string& pattern) override {
+        cache_engine::print_cache_stats(pattern);
+        cout << "Writebacks: " << writebacks << ", Writeback Bytes: " << writeback_bytes
+             << ", Write-through Bytes: " << write_through_bytes << "\n";
+        if (pf) {
+            int used = useful_prefetches + late_prefetches;
+            cout << "Prefetches: " << prefetches_issued << ", Useful: " << useful_prefetches
+                 << ", Late: " << late_prefetches << ", Useless: " << useless_prefetches
+                 << ", Pollution Misses: " << pollution_misses
+                 << ", Accuracy: " << (prefetches_issued ? used * 100.0 / prefetches_issued : 0.0) << "%"
+                 << ", Coverage: " << useful_prefetches * 100.0 / (useful_prefetches + cache_misses) << "%\n";
+        }
+        if (stream_bufs) {
+            cout << "Hits Served by Stream Buffers: " << stream_buffer_hits << "\n";
+        }
+        if (low_priority_fills || non_temporal_bypasses || software_prefetches) {
+            cout << "Low-priority Fills: " << low_priority_fills
+                 << ", Non-temporal Store Bypasses: " << non_temporal_bypasses
+                 << ", Software Prefetches: " << software_prefetches << "\n";
+        }
+        if (multi_byte_accesses) {
+            cout << "Multi-byte Accesses: " << multi_byte_accesses << ", Split Accesses: " << split_accesses
+                 << " (" << split_accesses * 100.0 / multi_byte_accesses << "%)\n";
+        }
+        if (coherence_invalidations || coherence_downgrades) {
+            cout << "Coherence: Invalidated Lines: " << coherence_invalidations
+                 << ", Downgraded Lines: " << coherence_downgrades << "\n";
+        }
+        if (flushed_lines || cleaned_lines || invalidated_lines) {
+            cout << "Maintenance: Flushed Lines: " << flushed_lines << ", Cleaned Lines: " << cleaned_lines
+                 << ", Invalidated Lines: " << invalidated_lines
+                 << ", Dirty Lines Discarded: " << discarded_dirty_lines
+                 << ", Range Set Walks: " << maintenance_set_walks << "\n";
+        }
+        size_t locked_lines = 0, locked_sets = 0;
+        for (size_t set_idx = 0; set_idx < num_sets; ++set_idx) {
+            drop_stale_locks(set_idx);
+            const cache_set& set = sets[set_idx];
+            for (int way = 0; way < NUM_WAYS; ++way) {
+                locked_lines += (set.locked_ways >> way) & 1;
+            }
+            locked_sets += set.locked_ways != 0;
+        }
+        if (locked_lines) {
+            size_t total_lines = num_sets * NUM_WAYS;
+            cout << "Locked Ways: " << locked_lines << " (" << locked_lines * block_size << " bytes, "
+                 << locked_lines * 100.0 / total_lines << "% of capacity) in " << locked_sets << " sets"
+                 << ", Unlocked Ways per Locked Set: "
+                 << (locked_sets * NUM_WAYS - locked_lines) / (double)locked_sets
+                 << ", Misses in Locked Sets: " << locked_set_misses
+                 << ", Bypassed Fills: " << bypassed_fills << "\n";
+        }
+        if (asid_policy != ASID_NONE) {
+            cout << "Address Spaces (" << (asid_policy == ASID_TAGGED ? "ASID-tagged" : "flush on switch")
+                 << "): Context Switches: " << context_switches
+                 << ", Cross-process Evictions: " << cross_process_evictions
+                 << ", Stale Dirty Writebacks: " << stale_writebacks << "\n";
+            for (size_t asid = 0; asid < asid_hits.size(); ++asid) {
+                int total = asid_hits[asid] + asid_misses[asid];
+                if (total) {
+                    cout << "  ASID " << asid << ": Accesses: " << total
+                         << ", Hit Rate: " << asid_hits[asid] * 100.0 / total << "%\n";
+                }
+            }
+        }
+    }
+};
+
+// Inclusion policy between the levels of a cache hierarchy
+enum inclusion_policy { INCLUSIVE, EXCLUSIVE, NINE };
+
+// Chains set-associative caches into a multi-level hierarchy (L1, L2, L3, ...), each
+// with its own geometry and write policy. The first level holds the data and reads
+// and writes main memory itself; lower levels track tags and dirty state only.
+// References are replayed in batches: the first level processes a whole batch and
+// its misses and victims are then handed to the next level as one event stream,
+// so lower levels are only visited for the traffic that actually reaches them.
+// Batching never changes the results. Exclusive levels hand a dirty hit to the
+// block's next event in stream order. Inclusive back-invalidations must reach the
+// upper levels before their next reference, so inclusive batches end at each L1 miss.
+class cache_hierarchy {
+public:
+    enum event_kind { EVENT_MISS, EVENT_VICTIM };
+
+    // Traffic leaving a level: a demand miss, or an evicted block (dirty victims in
+    // all modes, clean victims too in exclusive mode)
+    struct level_event {
+        size_t address;
+        event_kind kind;
+        bool dirty;
+    };
+
+    vector<set_associative_cache*> levels;
+    inclusion_policy policy;
+    size_t batch_size;
+    vector<int> level_hits, level_misses;
+    int total_references, back_invalidations, memory_reads, memory_writebacks;
+    vector<level_event> events, next_events; // Event streams reused across batches
+    unordered_set<size_t> pending_dirty;     // Exclusive dirty hits whose block is now above this level
+
+    cache_hierarchy(const vector<set_associative_cache*>& levels, inclusion_policy policy,
+                    size_t batch_size = 256) {
+        this->levels = levels;
+        this->policy = policy;
+        this->batch_size = batch_size;
+        for (size_t i = 1; i < levels.size(); ++i) {
+            levels[i]->tag_only = true;
+        }
+        reset_stats();
+    }
+
+    void reset_stats() {
+        level_hits.assign(levels.size(), 0);
+        level_misses.assign(levels.size(), 0);
+        total_references = 0;
+        back_invalidations = 0;
+        memory_reads = 0;
+        memory_writebacks = 0;
+    }
+
+    // Runs one reference through the first level and records the traffic it causes
+    void access_first_level(const trace_record& record) {
+        set_associative_cache& l1 = *levels[0];
+        if (record.type == ACCESS_WRITE) {
+            l1.write_to_cache(record.address, record.value);
+        } else {
+            l1.read_from_cache(record.address);
+        }
+
+        total_references++;
+        if (l1.last_access_hit) {
+            level_hits[0]++;
+            return;
+        }
+        level_misses[0]++;
+        events.push_back({record.address, EVENT_MISS, false});
+        if (l1.last_evicted_valid && (policy == EXCLUSIVE || l1.last_evicted_dirty)) {
+            events.push_back({l1.last_evicted_address, EVENT_VICTIM, l1.last_evicted_dirty});
+        }
+    }
+
+    // Inserts a block into a lower level and passes its victim on, back-invalidating
+    // the upper levels first when the hierarchy is inclusive
+    void fill_level(size_t level, size_t address, bool dirty) {
+        set_associative_cache& cache = *levels[level];
+        cache.insert_block(address, dirty);
+        if (!cache.last_evicted_valid) {
+            return;
+        }
+
+        size_t victim = cache.last_evicted_address;
+        bool victim_dirty = cache.last_evicted_dirty;
+        if (policy == INCLUSIVE) {
+            for (size_t upper = 0; upper < level; ++upper) {
+                bool upper_dirty;
+                if (levels[upper]->drop_block(victim, upper_dirty)) {
+                    back_invalidations++;
+                    victim_dirty = victim_dirty || upper_dirty;
+                }
+            }
+        }
+        if (policy == EXCLUSIVE || victim_dirty) {
+            next_events.push_back({victim, EVENT_VICTIM, victim_dirty});
+        }
+    }
+
+    // Processes the event stream coming from the level above
+    void process_level(size_t level) {
+        set_associative_cache& cache = *levels[level];
+        next_events.clear();
+        for (const level_event& event : events) {
+            if (event.kind == EVENT_MISS) {
+                if (cache.probe_block(event.address) != -1) {
+                    level_hits[level]++;
+                    if (policy == EXCLUSIVE) {
+                        // The block moves up to the first level, keeping its dirty state.
+                        // The upper levels have run ahead, so the dirty state goes to the
+                        // block's next victim event in this stream, or at the end of the
+                        // stream to whichever upper level holds the block by then.
+                        bool was_dirty;
+                        cache.drop_block(event.address, was_dirty);
+                        if (was_dirty) {
+                            pending_dirty.insert(event.address / cache.block_size);
+                        }
+                    }
+                } else {
+                    level_misses[level]++;
+                    next_events.push_back(event);
+                    if (policy != EXCLUSIVE) {
+                        fill_level(level, event.address, false);
+                    }
+                }
+            } else if (policy == EXCLUSIVE) {
+                bool carried = pending_dirty.erase(event.address / cache.block_size) > 0;
+                fill_level(level, event.address, event.dirty || carried);
+            } else if (cache.probe_block(event.address) != -1) {
+                cache.mark_dirty(event.address);
+            } else {
+                // Writeback of a block this level does not hold goes further down
+                next_events.push_back(event);
+            }
+        }
+        for (size_t block : pending_dirty) {
+            for (size_t upper = 0; upper < level; ++upper) {
+                if (levels[upper]->mark_dirty(block * cache.block_size)) {
+                    break;
+                }
+            }
+        }
+        pending_dirty.clear();
+        events.swap(next_events);
+    }
+
+    // Hands the events of the current batch down the levels
+    void finish_batch() {
+        for (size_t level = 1; level < levels.size() && !events.empty(); ++level) {
+            process_level(level);
+        }
+
+        // Whatever leaves the last level is memory traffic
+        for (const level_event& event : events) {
+            if (event.kind == EVENT_MISS) {
+                memory_reads++;
+            } else if (event.dirty) {
+                memory_writebacks++;
+            }
+        }
+        events.clear();
+    }
+
+    // Applies a maintenance record to every level. A block dirty in any level is
+    // written to memory once by a flush or clean; an invalidate discards it.
+    void maintain(const trace_record& record) {
+        size_t block_size = levels[0]->block_size;
+        size_t len = max((size_t)record.size, (size_t)1);
+        size_t first_block = record.address / block_size;
+        size_t end_block = (record.address + len + block_size - 1) / block_size;
+        for (size_t block = first_block; block < end_block; ++block) {
+            size_t block_start = block * block_size;
+            bool dirty = false;
+            for (set_associative_cache* cache : levels) {
+                size_t set_idx = cache->extract_index(block_start);
+                int way = cache->find_way(set_idx, cache->extract_tag(block_start));
+                if (way != -1) {
+                    dirty = dirty || cache->sets[set_idx].lines[way].dirty;
+                    cache->maintain_line(record.type, set_idx, way);
+                }
+            }
+            if (dirty && record.type != ACCESS_INVALIDATE) {
+                memory_writebacks++;
+            }
+        }
+    }
+
+    // Replays a trace through the hierarchy, batch_size references at a time. A
+    // maintenance, fence or context-switch record ends the current batch, so that
+    // it sees the effect of every earlier reference on every level.
+    void replay(const vector<trace_record>& trace) {
+        events.clear();
+        size_t batched = 0;
+        for (const trace_record& record : trace) {
+            if (is_memory_reference(record.type)) {
+                access_first_level(record);
+                if (++batched == batch_size || (policy == INCLUSIVE && !events.empty())) {
+                    finish_batch();
+                    batched = 0;
+                }
+                continue;
+            }
+            finish_batch();
+            batched = 0;
+            if (is_maintenance(record.type)) {
+                maintain(record);
+            } else if (record.type == ACCESS_CONTEXT_SWITCH) {
+                for (set_associative_cache* cache : levels) {
+                    cache->access(record);
+                }
+            } else {
+                levels[0]->access(record);
+            }
+        }
+        finish_batch();
+    }
+
+    void print_stats(const string& pattern) {
+        const char* policy_names[] = {"Inclusive", "Exclusive", "NINE"};
+        cout << "\nHierarchy Stats for " << pattern << " (" << policy_names[policy] << "):\n";
+        for (size_t i = 0; i < levels.size(); ++i) {
+            int requests = level_hits[i] + level_misses[i];
+            cout << "L" << i + 1 << ": Hits: " << level_hits[i] << ", Misses: " << level_misses[i]
+                 << ", Local Miss Rate: " << (requests ? level_misses[i] * 100.0 / requests : 0.0) << "%"
+                 << ", Global Miss Rate: " << level_misses[i] * 100.0 / total_references << "%\n";
+        }
+        cout << "Memory Reads: " << memory_reads << ", Memory Writebacks: " << memory_writebacks
+             << ", Back-invalidations: " << back_invalidations << "\n";
+    }
+};
+
+// Front end with split L1 instruction and data caches over a unified L2. Fetch
+// records go to the L1I and loads and stores to the L1D; both L1s hold data, while
+// the L2 tracks tags and dirty state only and is filled by the misses of either
+// side without back-invalidating them (NINE). A fetch from the same block as the
+// previous fetch, the common case for straight-line code, is served from that
+// block without a tag lookup.
+class split_l1_front_end {
+public:
+    // Counters kept separately for the instruction and the data side
+    struct side_stats {
+        int references, l1_hits, l1_misses, l2_hits, l2_misses;
+    };
+
+    set_associative_cache& l1i;
+    set_associative_cache& l1d;
+    set_associative_cache& l2;
+    size_t last_fetch_block;  // Block of the most recent instruction fetch
+    bool last_fetch_valid;
+    side_stats inst, data;
+    int coalesced_fetches, block_crossings, memory_reads, memory_writebacks;
+
+    split_l1_front_end(set_associative_cache& l1i, set_associative_cache& l1d, set_associative_cache& l2)
+        : l1i(l1i), l1d(l1d), l2(l2) {
+        l2.tag_only = true;
+        reset_stats();
+    }
+
+    void reset_stats() {
+        inst = {0, 0, 0, 0, 0};
+        data = {0, 0, 0, 0, 0};
+        coalesced_fetches = 0;
+        block_crossings = 0;
+        memory_reads = 0;
+        memory_writebacks = 0;
+        last_fetch_valid = false;
+    }
+
+    // Fills the L2 and sends its dirty victim to memory
+    void fill_l2(size_t address, bool dirty) {
+        l2.insert_block(address, dirty);
+        if (l2.last_evicted_valid && l2.last_evicted_dirty) {
+            memory_writebacks++;
+        }
+    }
+
+    // Accounts the outcome of an L1 access and passes a miss and the dirty victim
+    // it displaced on to the L2
+    void after_l1_access(set_associative_cache& l1, side_stats& side, size_t address) {
+        if (l1.last_access_hit) {
+            side.l1_hits++;
+            return;
+        }
+        side.l1_misses++;
+        bool victim_dirty = l1.last_evicted_valid && l1.last_evicted_dirty;
+        size_t victim = l1.last_evicted_address;
+        if (l2.probe_block(address) != -1) {
+            side.l2_hits++;
+        } else {
+            side.l2_misses++;
+            memory_reads++;
+            fill_l2(address, false);
+        }
+        if (victim_dirty && !l2.mark_dirty(victim)) {
+            // Writeback of a block the L2 does not hold goes to memory
+            memory_writebacks++;
+        }
+    }
+
+    // Fetches size bytes of instructions starting at address
+    void fetch(size_t address, size_t size) {
+        size_t first = address / l1i.block_size;
+        size_t last = (address + max(size, (size_t)1) - 1) / l1i.block_size;
+        inst.references++;
+        for (size_t block = first; block <= last; ++block) {
+            if (block != first) {
+                block_crossings++;
+            }
+            if (last_fetch_valid && block == last_fetch_block) {
+                coalesced_fetches++;
+                inst.l1_hits++;
+                continue;
+            }
+            size_t block_address = block == first ? address : block * l1i.block_size;
+            l1i.read_from_cache(block_address);
+            after_l1_access(l1i, inst, block_address);
+            last_fetch_block = block;
+            last_fetch_valid = true;
+        }
+    }
+
+    // Performs a load or store, touching a second block if the reference crosses
+    // a block boundary
+    void data_access(const trace_record& record) {
+        size_t first = record.address / l1d.block_size;
+        size_t last = (record.address + max((size_t)record.size, (size_t)1) - 1) / l1d.block_size;
+        data.references++;
+        for (size_t block = first; block <= last; ++block) {
+            size_t address = block == first ? record.address : block * l1d.block_size;
+            if (record.type == ACCESS_WRITE) {
+                l1d.write_to_cache(address, record.value);
+            } else {
+                l1d.read_from_cache(address);
+            }
+            after_l1_access(l1d, data, address);
+        }
+    }
+
+    // Applies a maintenance record to the L1I, the L1D and the L2. A block dirty in
+    // either data level is written to memory once by a flush or clean; the L1D
+    // writes its own data back, the L2 only contributes its dirty bit.
+    void maintain(const trace_record& record) {
+        size_t block_size = l1d.block_size;
+        size_t len = max((size_t)record.size, (size_t)1);
+        size_t first_block = record.address / block_size;
+        size_t end_block = (record.address + len + block_size - 1) / block_size;
+        set_associative_cache* caches[] = {&l1i, &l1d, &l2};
+        for (size_t block = first_block; block < end_block; ++block) {
+            size_t block_start = block * block_size;
+            bool dirty = false;
+            for (set_associative_cache* cache : caches) {
+                size_t set_idx = cache->extract_index(block_start);
+                int way = cache->find_way(set_idx, cache->extract_tag(block_start));
+                if (way != -1) {
+                    dirty = dirty || cache->sets[set_idx].lines[way].dirty;
+                    cache->maintain_line(record.type, set_idx, way);
+                }
+            }
+            if (dirty && record.type != ACCESS_INVALIDATE) {
+                memory_writebacks++;
+            }
+            if (record.type != ACCESS_CLEAN && last_fetch_valid && last_fetch_block == block_start / l1i.block_size) {
+                last_fetch_valid = false;
+            }
+        }
+    }
+
+    void access(const trace_record& record) {
+        if (record.type == ACCESS_IFETCH) {
+            fetch(record.address, record.size);
+        } else if (is_maintenance(record.type)) {
+            maintain(record);
+        } else if (record.type == ACCESS_FENCE) {
+            // Only the L1D holds stores for a fence to order
+            l1d.access(record);
+        } else if (record.type == ACCESS_CONTEXT_SWITCH) {
+            last_fetch_valid = false;
+            l1i.access(record);
+            l1d.access(record);
+            l2.access(record);
+        } else {
+            data_access(record);
+        }
+    }
+
+    void replay(const vector<trace_record>& trace) {
+        for (const trace_record& record : trace) {
+            access(record);
+        }
+    }
+
+    // Both L1 miss rates are per block access: a reference crossing a block boundary
+    // counts twice, and a coalesced fetch counts as a hit without a tag lookup
+    void print_stats(const string& pattern) {
+        int fetch_accesses = inst.l1_hits + inst.l1_misses;
+        int data_accesses = data.l1_hits + data.l1_misses;
+        int l2_requests = inst.l1_misses + data.l1_misses;
+        int l2_misses = inst.l2_misses + data.l2_misses;
+        cout << "\nSplit L1 Stats for " << pattern << ":\n";
+        cout << "L1I: Fetches: " << inst.references << ", Block Accesses: " << fetch_accesses
+             << ", Hits: " << inst.l1_hits << ", Misses: " << inst.l1_misses
+             << ", Miss Rate: " << (fetch_accesses ? inst.l1_misses * 100.0 / fetch_accesses : 0.0) << "%"
+             << ", Tag Lookups: " << fetch_accesses - coalesced_fetches << ", Coalesced: " << coalesced_fetches
+             << ", Block Crossings: " << block_crossings << "\n";
+        cout << "L1D: References: " << data.references << ", Block Accesses: " << data_accesses
+             << ", Hits: " << data.l1_hits << ", Misses: " << data.l1_misses
+             << ", Miss Rate: " << (data_accesses ? data.l1_misses * 100.0 / data_accesses : 0.0) << "%\n";
+        cout << "L2: Instruction Hits: " << inst.l2_hits << ", Instruction Misses: " << inst.l2_misses
+             << ", Data Hits: " << data.l2_hits << ", Data Misses: " << data.l2_misses
+             << ", Local Miss Rate: " << (l2_requests ? l2_misses * 100.0 / l2_requests : 0.0) << "%\n";
+        cout << "Memory Reads: " << memory_reads << ", Memory Writebacks: " << memory_writebacks << "\n";
+    }
+};
+
+// Inclusive snoop filter: a set-associative, tag-only directory of the blocks held
+// by a group of private caches, with a vector of the cores that may hold each one.
+// Every block cached by a core has an entry, so coherence probes only go to the
+// cores in its vector, and evicting an entry forces its sharers to drop the block.
+class snoop_filter {
+public:
+    size_t num_sets;
+    vector<cache_set> sets;    // Tag-only entries with PLRU replacement
+    vector<uint64_t> sharers;  // Core bit vector per entry (at most 64 cores)
+    int lookups, entry_evictions;
+
+    snoop_filter(size_t num_entries) {
+        this->num_sets = max((size_t)1, num_entries / NUM_WAYS);
+        this->sets.resize(num_sets, cache_set(0));
+        this->sharers.assign(num_sets * NUM_WAYS, 0);
+        this->lookups = 0;
+        this->entry_evictions = 0;
+    }
+
+    // Entries are indexed by a multiplicative hash of the block number, so that
+    // regions aligned to the same boundary in different cores spread over all sets;
+    // the tag is the whole block number
+    size_t set_of(size_t block) {
+        return (size_t)((block * 0x9e3779b97f4a7c15ULL) >> 32) % num_sets;
+    }
+
+    // Returns the way tracking a block number in its set, or -1
+    int find(size_t block) {
+        cache_set& set = sets[set_of(block)];
+        for (int way = 0; way < NUM_WAYS; ++way) {
+            if (set.lines[way].valid && set.lines[way].tag == block) {
+                return way;
+            }
+        }
+        return -1;
+    }
+
+    // Cores that may hold a block
+    uint64_t lookup(size_t block) {
+        lookups++;
+        int way = find(block);
+        if (way == -1) {
+            return 0;
+        }
+        sets[set_of(block)].updatePLRU(way);
+        return sharers[set_of(block) * NUM_WAYS + way];
+    }
+
+    // Records that a core holds a block. Returns true if an entry had to be evicted
+    // to track it, with the evicted block and its sharers in victim and victim_sharers.
+    bool add_sharer(size_t block, size_t core, size_t& victim, uint64_t& victim_sharers) {
+        assert(core < 64);
+        size_t set_idx = set_of(block);
+        cache_set& set = sets[set_idx];
+        int way = find(block);
+        bool evicted = false;
+        if (way == -1) {
+            for (int i = 0; i < NUM_WAYS && way == -1; ++i) {
+                if (!set.lines[i].valid) {
+                    way = i;
+                }
+            }
+            if (way == -1) {
+                way = set.findPLRUVictim();
+                victim = set.lines[way].tag;
+                victim_sharers = sharers[set_idx * NUM_WAYS + way];
+                entry_evictions++;
+                evicted = true;
+            }
+            set.lines[way].valid = true;
+            set.lines[way].tag = block;
+            sharers[set_idx * NUM_WAYS + way] = 0;
+        }
+        sharers[set_idx * NUM_WAYS + way] |= (uint64_t)1 << core;
+        set.updatePLRU(way);
+        return evicted;
+    }
+
+    // Records that a core no longer holds a block, freeing the entry once no core does
+    void remove_sharer(size_t block, size_t core) {
+        int way = find(block);
+        if (way == -1) {
+            return;
+        }
+        size_t idx = set_of(block) * NUM_WAYS + way;
+        sharers[idx] &= ~((uint64_t)1 << core);
+        if (!sharers[idx]) {
+            sets[set_of(block)].lines[way].valid = false;
+        }
+    }
+};
+
+// Private data caches of several cores kept coherent by write-invalidate probes.
+// A read miss probes the other holders of the block so that a dirty copy is written
+// back first; a write to a block that is not already dirty in the writer's cache
+// invalidates every other copy. With a snoop_filter, probes go
+// only to the cores in the block's sharer vector and private-cache evictions update
+// it; without one, every request is broadcast to all other cores. Prefetch fills of
+// a private cache are coherent reads like demand misses.
+class private_cache_system {
+public:
+    vector<set_associative_cache*> cores;
+    snoop_filter* filter;
+    int coherence_requests, probes_sent, broadcast_probes;
+    int invalidations, downgrades, filter_back_invalidations;
+    vector<size_t> due_prefetches;  // Scratch list for complete_prefetches()
+
+    // Sharer vectors are 64-bit masks, so at most 64 cores are supported
+    private_cache_system(const vector<set_associative_cache*>& cores, snoop_filter* filter) {
+        assert(cores.size() <= 64);
+        this->cores = cores;
+        this->filter = filter;
+        this->coherence_requests = 0;
+        this->probes_sent = 0;
+        this->broadcast_probes = 0;
+        this->invalidations = 0;
+        this->downgrades = 0;
+        this->filter_back_invalidations = 0;
+    }
+
+    // Delivers a probe for the block at address to a core: a write probe invalidates
+    // its copy (writing back dirty data), a read probe writes back a dirty copy
+    void probe(size_t core, size_t address, bool is_write) {
+        probes_sent++;
+        set_associative_cache& cache = *cores[core];
+        if (is_write) {
+            if (cache.coherence_invalidate(address)) {
+                invalidations++;
+            }
+            if (filter) {
+                filter->remove_sharer(address / cache.block_size, core);
+            }
+        } else if (cache.coherence_downgrade(address)) {
+            downgrades++;
+        }
+    }
+
+    // Sends a core's read or write request for a block to the other cores that may
+    // hold it
+    void request_block(size_t core, size_t block_start, bool is_write) {
+        size_t block = block_start / cores[core]->block_size;
+        coherence_requests++;
+        broadcast_probes += cores.size() - 1;
+        uint64_t targets = filter ? filter->lookup(block) : ~(uint64_t)0;
+        for (size_t other = 0; other < cores.size(); ++other) {
+            if (other != core && (targets >> other & 1)) {
+                probe(other, block_start, is_write);
+            }
+        }
+    }
+
+    // Records a block newly cached by a core in the snoop filter. Inclusion: every
+    // core that may hold the entry the filter displaces must drop that block.
+    void track_fill(size_t core, size_t block) {
+        size_t victim;
+        uint64_t victim_sharers;
+        if (!filter->add_sharer(block, core, victim, victim_sharers)) {
+            return;
+        }
+        for (size_t other = 0; other < cores.size(); ++other) {
+            if ((victim_sharers >> other & 1) &&
+                cores[other]->coherence_invalidate(victim * cores[other]->block_size)) {
+                filter_back_invalidations++;
+            }
+        }
+    }
+
+    // Installs the prefetches of a core that fall due at its next access before
+    // that access runs, each as a coherent read tracked by the snoop filter
+    void complete_prefetches(size_t core) {
+        set_associative_cache& cache = *cores[core];
+        due_prefetches.clear();
+        cache.take_due_prefetches(due_prefetches, (uint64_t)cache.total_accesses + 1);
+        for (size_t block_start : due_prefetches) {
+            size_t set_idx = cache.extract_index(block_start);
+            if (cache.find_way(set_idx, cache.extract_tag(block_start)) != -1) {
+                continue;
+            }
+            request_block(core, block_start, false);
+            bool displaced;
+            size_t victim;
+            if (!cache.prefetch_fill(block_start, displaced, victim) || !filter) {
+                continue;
+            }
+            if (displaced) {
+                filter->remove_sharer(victim / cache.block_size, core);
+            }
+            track_fill(core, block_start / cache.block_size);
+        }
+    }
+
+    // Performs one record of a core, block by block. Maintenance records act on the
+    // block in every core, like clflush in a coherent system; fences and context
+    // switches act on the issuing core only.
+    void access(size_t core, const trace_record& record) {
+        set_associative_cache& cache = *cores[core];
+        if (!is_memory_reference(record.type) && !is_maintenance(record.type)) {
+            cache.access(record);
+            return;
+        }
+        size_t len = max((size_t)record.size, (size_t)1);
+        for (size_t address = record.address; address < record.address + len;) {
+            size_t chunk = min(record.address + len - address, cache.block_size - address % cache.block_size);
+            trace_record piece = record;
+            piece.address = address;
+            piece.size = chunk;
+            if (is_maintenance(record.type)) {
+                maintain_block(piece);
+            } else {
+                access_block(core, piece);
+            }
+            address += chunk;
+        }
+    }
+
+    // Applies a maintenance record for one block to every core's copy
+    void maintain_block(const trace_record& record) {
+        for (size_t core = 0; core < cores.size(); ++core) {
+            cores[core]->maintain_block(record.type, record.address);
+            if (filter && record.type != ACCESS_CLEAN) {
+                filter->remove_sharer(record.address / cores[core]->block_size, core);
+            }
+        }
+    }
+
+    void access_block(size_t core, const trace_record& record) {
+        set_associative_cache& cache = *cores[core];
+        if (cache.pf) {
+            complete_prefetches(core);
+        }
+        size_t block = record.address / cache.block_size;
+        size_t block_start = block * cache.block_size;
+        bool is_write = record.type == ACCESS_WRITE;
+        size_t set_idx = cache.extract_index(block_start);
+        int way = cache.find_way(set_idx, cache.extract_tag(block_start));
+        // A dirty copy is the only one, so writing it again needs no probes
+        bool exclusive = way != -1 && cache.sets[set_idx].lines[way].dirty;
+        if (way == -1 || (is_write && !exclusive)) {
+            request_block(core, block_start, is_write);
+        }
+
+        cache.access(record);
+        if (!filter) {
+            return;
+        }
+        if (cache.last_evicted_valid) {
+            filter->remove_sharer(cache.last_evicted_address / cache.block_size, core);
+        }
+        if (cache.find_way(set_idx, cache.extract_tag(block_start)) == -1) {
+            return;  // Not allocated (no-allocate store or fully locked set)
+        }
+        track_fill(core, block);
+    }
+
+    void print_stats(const string& pattern) {
+        cout << "\nCoherence Stats for " << pattern << " (" << cores.size() << " cores, "
+             << (filter ? "snoop filter" : "broadcast") << "):\n";
+        int hits = 0, misses = 0;
+        for (set_associative_cache* cache : cores) {
+            hits += cache->cache_hits;
+            misses += cache->cache_misses;
+        }
+        cout << "Private Cache Hits: " << hits << ", Misses: " << misses
+             << ", Hit Rate: " << hits * 100.0 / (hits + misses) << "%\n";
+        cout << "Coherence Requests: " << coherence_requests << ", Probes Sent: " << probes_sent
+             << ", Broadcast Probes: " << broadcast_probes
+             << ", Probes Avoided: " << broadcast_probes - probes_sent << " ("
+             << (broadcast_probes ? (broadcast_probes - probes_sent) * 100.0 / broadcast_probes : 0.0) << "%)\n";
+        cout << "Invalidations: " << invalidations << ", Downgrades: " << downgrades;
+        if (filter) {
+            cout << ", Filter Entry Evictions: " << filter->entry_evictions
+                 << ", Filter Back-invalidations: " << filter_back_invalidations;
+        }
+        cout << "\n";
+    }
+};
+
+// Non-uniform cache access (NUCA) last-level cache split into slices on a 2D mesh,
+// one slice per tile. A block lives in the slice chosen by a hash of its block
+// number; an access from a core costs the slice latency (plus memory latency on a
+// miss) and hop_latency per mesh hop each way. With migration enabled, a block
+// accessed migration_threshold times in a row by the same remote core moves one hop
+// toward that core; a location table records where migrated blocks live.
+class nuca_cache {
+public:
+    size_t mesh_width, mesh_height;
+    vector<set_associative_cache> slices;  // Slice i sits on tile i (row-major)
+    vector<size_t> core_tiles;             // Tile of each core
+    uint64_t slice_latency, hop_latency, memory_latency;
+    bool migration;
+    int migration_threshold, migrations;
+    unordered_map<size_t, size_t> migrated_blocks;        // Block number -> current slice
+    unordered_map<size_t, pair<size_t, int>> remote_streaks;  // Block number -> (core, run length)
+    vector<map<uint64_t, int>> latency_histograms;  // Per core: latency -> accesses
+
+    nuca_cache(size_t mesh_width, size_t mesh_height, size_t block_size, size_t slice_size,
+               main_memory& memory, const vector<size_t>& core_tiles, uint64_t slice_latency = 10,
+               uint64_t hop_latency = 2, uint64_t memory_latency = 100)
+        : slices(mesh_width * mesh_height, set_associative_cache(block_size, slice_size, memory)) {
+        this->mesh_width = mesh_width;
+        this->mesh_height = mesh_height;
+        this->core_tiles = core_tiles;
+        this->slice_latency = slice_latency;
+        this->hop_latency = hop_latency;
+        this->memory_latency = memory_latency;
+        this->migration = false;
+        this->migration_threshold = 4;
+        this->migrations = 0;
+        this->latency_histograms.resize(core_tiles.size());
+    }
+
+    size_t hops(size_t from_tile, size_t to_tile) {
+        size_t dx = from_tile % mesh_width > to_tile % mesh_width ? from_tile % mesh_width - to_tile % mesh_width
+                                                                  : to_tile % mesh_width - from_tile % mesh_width;
+        size_t dy = from_tile / mesh_width > to_tile / mesh_width ? from_tile / mesh_width - to_tile / mesh_width
+                                                                  : to_tile / mesh_width - from_tile / mesh_width;
+        return dx + dy;
+    }
+
+    // Home slice of a block: a multiplicative hash of the block number
+    size_t home_slice(size_t block) {
+        return (size_t)((block * 0x9e3779b97f4a7c15ULL) >> 32) % slices.size();
+    }
+
+    size_t slice_of(size_t block) {
+        if (migration) {
+            auto it = migrated_blocks.find(block);
+            if (it != migrated_blocks.end()) {
+                return it->second;
+            }
+        }
+        return home_slice(block);
+    }
+
+    // Performs one block-sized piece of a record in a slice and returns its latency.
+    // Only the slice is touched, so different slices can run on different threads.
+    uint64_t access_slice(size_t slice, size_t core, const trace_record& record) {
+        set_associative_cache& cache = slices[slice];
+        cache.access(record);
+        uint64_t latency = slice_latency + 2 * hop_latency * hops(core_tiles[core], slice);
+        return cache.last_access_hit ? latency : latency + memory_latency;
+    }
+
+    // Moves a block one hop along the X-then-Y route toward a tile
+    void migrate(size_t block, size_t from, size_t toward) {
+        size_t to = from;
+        if (from % mesh_width != toward % mesh_width) {
+            to = from % mesh_width < toward % mesh_width ? from + 1 : from - 1;
+        } else {
+            to = from / mesh_width < toward / mesh_width ? from + mesh_width : from - mesh_width;
+        }
+        size_t block_start = block * slices[from].block_size;
+        bool was_dirty;
+        slices[from].drop_block(block_start, was_dirty);
+        slices[to].preload_cache(block_start, 1);
+        forget_victim(to);
+        if (to == home_slice(block)) {
+            migrated_blocks.erase(block);
+        } else {
+            migrated_blocks[block] = to;
+        }
+        migrations++;
+    }
+
+    // Drops the location of a migrated block once its slice evicts it
+    void forget_victim(size_t slice) {
+        set_associative_cache& cache = slices[slice];
+        if (cache.last_evicted_valid) {
+            auto it = migrated_blocks.find(cache.last_evicted_address / cache.block_size);
+            if (it != migrated_blocks.end() && it->second == slice) {
+                migrated_blocks.erase(it);
+            }
+        }
+    }
+
+    // Splits a record into pieces that stay within one block
+    void split_blocks(const trace_record& record, vector<trace_record>& pieces) {
+        size_t block_size = slices[0].block_size;
+        size_t len = max((size_t)record.size, (size_t)1);
+        pieces.clear();
+        for (size_t address = record.address; address < record.address + len;) {
+            trace_record piece = record;
+            piece.address = address;
+            piece.size = min(record.address + len - address, block_size - address % block_size);
+            pieces.push_back(piece);
+            address += piece.size;
+        }
+    }
+
+    // Maintenance records act on the slice holding each block, fences and context
+    // switches on every slice; neither is timed as an access
+    void apply_non_reference(const trace_record& record) {
+        if (!is_maintenance(record.type)) {
+            for (set_associative_cache& slice : slices) {
+                slice.access(record);
+            }
+            return;
+        }
+        vector<trace_record> pieces;
+        split_blocks(record, pieces);
+        for (const trace_record& piece : pieces) {
+            slices[slice_of(piece.address / slices[0].block_size)].access(piece);
+        }
+    }
+
+    void access(size_t core, const trace_record& record) {
+        if (!is_memory_reference(record.type)) {
+            apply_non_reference(record);
+            return;
+        }
+        vector<trace_record> pieces;
+        split_blocks(record, pieces);
+        for (const trace_record& piece : pieces) {
+            size_t block = piece.address / slices[0].block_size;
+            size_t slice = slice_of(block);
+            latency_histograms[core][access_slice(slice, core, piece)]++;
+            if (!migration) {
+                continue;
+            }
+            forget_victim(slice);
+            if (slice == core_tiles[core] || !slices[slice].last_access_hit) {
+                continue;
+            }
+            pair<size_t, int>& streak = remote_streaks[block];
+            if (streak.first != core || streak.second == 0) {
+                streak = make_pair(core, 0);
+            }
+            if (++streak.second >= migration_threshold) {
+                remote_streaks.erase(block);
+                migrate(block, slice, core_tiles[core]);
+            }
+        }
+    }
+
+    // Replays (core, record) pairs. Without migration every block stays in its home
+    // slice, so the trace is partitioned by slice and the slices run on their own
+    // threads, each in trace order; with migration the replay is sequential.
+    void replay(const vector<pair<size_t, trace_record>>& trace) {
+        if (migration) {
+            for (const auto& entry : trace) {
+                access(entry.first, entry.second);
+            }
+            return;
+        }
+
+        vector<vector<pair<size_t, trace_record>>> slice_traces(slices.size());
+        vector<trace_record> pieces;
+        for (const auto& entry : trace) {
+            if (!is_memory_reference(entry.second.type) && !is_maintenance(entry.second.type)) {
+                for (auto& slice_trace : slice_traces) {
+                    slice_trace.push_back(entry);
+                }
+                continue;
+            }
+            split_blocks(entry.second, pieces);
+            for (const trace_record& piece : pieces) {
+                slice_traces[home_slice(piece.address / slices[0].block_size)].push_back({entry.first, piece});
+            }
+        }
+        vector<vector<map<uint64_t, int>>> slice_histograms(slices.size(), vector<map<uint64_t, int>>(core_tiles.size()));
+        vector<thread> workers;
+        for (size_t slice = 0; slice < slices.size(); ++slice) {
+            workers.emplace_back([this, slice, &slice_traces, &slice_histograms]() {
+                for (const auto& entry : slice_traces[slice]) {
+                    if (is_memory_reference(entry.second.type)) {
+                        slice_histograms[slice][entry.first][access_slice(slice, entry.first, entry.second)]++;
+                    } else {
+                        slices[slice].access(entry.second);
+                    }
+                }
+            });
+        }
+        for (thread& worker : workers) {
+            worker.join();
+        }
+        for (size_t slice = 0; slice < slices.size(); ++slice) {
+            for (size_t core = 0; core < core_tiles.size(); ++core) {
+                for (const auto& bucket : slice_histograms[slice][core]) {
+                    latency_histograms[core][bucket.first] += bucket.second;
+                }
+            }
+        }
+    }
+
+    void print_stats(const string& pattern) {
+        int hits = 0, misses = 0;
+        for (set_associative_cache& slice : slices) {
+            hits += slice.cache_hits;
+            misses += slice.cache_misses;
+        }
+        cout << "\nNUCA Stats for " << pattern << " (" << mesh_width << "x" << mesh_height << " mesh, "
+             << (migration ? "migration" : "static placement") << "):\n";
+        cout << "Hits: " << hits << ", Misses: " << misses << ", Hit Rate: " << hits * 100.0 / (hits + misses) << "%"
+             << ", Migrations: " << migrations << "\n";
+        for (size_t core = 0; core < core_tiles.size(); ++core) {
+            const map<uint64_t, int>& histogram = latency_histograms[core];
+            int count = 0;
+            uint64_t total = 0;
+            for (const auto& bucket : histogram) {
+                count += bucket.second;
+                total += bucket.first * bucket.second;
+            }
+            if (!count) {
+                continue;
+            }
+            // Median and 95th percentile from the cumulative distribution
+            uint64_t p50 = 0, p95 = 0;
+            int seen = 0;
+            for (const auto& bucket : histogram) {
+                if (seen < (count + 1) / 2 && seen + bucket.second >= (count + 1) / 2) {
+                    p50 = bucket.first;
+                }
+                if (seen < (count * 95 + 99) / 100 && seen + bucket.second >= (count * 95 + 99) / 100) {
+                    p95 = bucket.first;
+                }
+                seen += bucket.second;
+            }
+            cout << "Core " << core << " (tile " << core_tiles[core] << "): Accesses: " << count
+                 << ", Avg Latency: " << (double)total / count << ", P50: " << p50 << ", P95: " << p95
+                 << ", Max: " << histogram.rbegin()->first << "\n  Latency Histogram:";
+            for (const auto& bucket : histogram) {
+                cout << " " << bucket.first << ":" << bucket.second;
+            }
+            cout << "\n";
+        }
+    }
+};
+
+// Organizations of a DRAM cache whose tags are stored in the DRAM itself
+enum dram_cache_organization { DRAM_CACHE_ALLOY, DRAM_CACHE_SET_ASSOCIATIVE };
+
+// Stacked-DRAM (L4) cache model for capacities in the GB range. It keeps no data,
+// only one packed 32-bit metadata word per line (valid, dirty and NRU bits and a
+// 29-bit tag), and accounts the DRAM-cache bandwidth spent on tags and on data.
+// - Alloy: direct-mapped; tag and data form one 72-byte unit streamed by a single
+//   probe, so a probe returns the data of a hit at once
+// - Set-associative: the tags of a set are read first (whole bursts of
+//   tag_entry_bytes per way) and the data of a hit second; NRU replacement
+// An optional MAP-I style predictor (2-bit counters indexed by a hash of the PC, or
+// of the page when no PC is given) sends predicted misses straight to memory
+// without a tag probe; their tags are only checked when the block is installed.
+class dram_cache {
+public:
+    static const uint32_t LINE_VALID = 1u << 31, LINE_DIRTY = 1u << 30, LINE_REFERENCED = 1u << 29;
+    static const uint32_t TAG_MASK = LINE_REFERENCED - 1;
+
+    dram_cache_organization organization;
+    size_t block_size, num_ways, num_sets, tag_entry_bytes;
+    vector<uint32_t> metadata;  // num_sets * num_ways packed line words
+    bool use_predictor;
+    vector<uint8_t> predictor;  // 2-bit counters; 2 and 3 predict a hit
+    uint64_t probe_latency, data_latency, memory_latency;
+    int hits, misses, writebacks, skipped_probes, predicted_miss_hits, predicted_hit_misses;
+    uint64_t tag_bytes, data_bytes, memory_bytes, total_latency;
+
+    dram_cache(dram_cache_organization organization, size_t capacity, size_t block_size, size_t num_ways,
+               bool use_predictor, uint64_t probe_latency = 30, uint64_t data_latency = 15,
+               uint64_t memory_latency = 80) {
+        this->organization = organization;
+        this->block_size = block_size;
+        this->num_ways = organization == DRAM_CACHE_ALLOY ? 1 : num_ways;
+        this->num_sets = capacity / (block_size * this->num_ways);
+        this->tag_entry_bytes = 8;
+        this->metadata.assign(num_sets * this->num_ways, 0);
+        this->use_predictor = use_predictor;
+        this->predictor.assign(4096, 3);
+        this->probe_latency = probe_latency;
+        this->data_latency = data_latency;
+        this->memory_latency = memory_latency;
+        this->hits = 0;
+        this->misses = 0;
+        this->writebacks = 0;
+        this->skipped_probes = 0;
+        this->predicted_miss_hits = 0;
+        this->predicted_hit_misses = 0;
+        this->tag_bytes = 0;
+        this->data_bytes = 0;
+        this->memory_bytes = 0;
+        this->total_latency = 0;
+    }
+
+    // Bytes moved by a tag probe: the tag of an Alloy unit, or the bursts holding
+    // every tag of a set
+    size_t probe_bytes() {
+        if (organization == DRAM_CACHE_ALLOY) {
+            return tag_entry_bytes;
+        }
+        return (num_ways * tag_entry_bytes + block_size - 1) / block_size * block_size;
+    }
+
+    // Sets the NRU bit of a line, clearing the others once every way has it
+    void reference(size_t set_idx, size_t way) {
+        uint32_t* set = &metadata[set_idx * num_ways];
+        set[way] |= LINE_REFERENCED;
+        for (size_t i = 0; i < num_ways; ++i) {
+            if (!(set[i] & LINE_REFERENCED)) {
+                return;
+            }
+        }
+        for (size_t i = 0; i < num_ways; ++i) {
+            if (i != way) {
+                set[i] &= ~LINE_REFERENCED;
+            }
+        }
+    }
+
+    // Installs a block, writing back a dirty victim
+    void fill(size_t set_idx, uint32_t tag, bool is_write) {
+        uint32_t* set = &metadata[set_idx * num_ways];
+        size_t way = 0;
+        while (way < num_ways && (set[way] & LINE_VALID)) {
+            way++;
+        }
+        if (way == num_ways) {
+            way = 0;
+            while (way < num_ways - 1 && (set[way] & LINE_REFERENCED)) {
+                way++;
+            }
+            if (set[way] & LINE_DIRTY) {
+                writebacks++;
+                data_bytes += block_size;
+                memory_bytes += block_size;
+            }
+        }
+        set[way] = LINE_VALID | tag | (is_write ? LINE_DIRTY : 0);
+        reference(set_idx, way);
+        data_bytes += block_size;
+        tag_bytes += tag_entry_bytes;
+    }
+
+    // Performs one block access and returns its latency
+    uint64_t access(size_t address, bool is_write, size_t pc = 0) {
+        size_t block = address / block_size;
+        size_t set_idx = block % num_sets;
+        uint32_t tag = (uint32_t)(block / num_sets) & TAG_MASK;
+        uint32_t* set = &metadata[set_idx * num_ways];
+        size_t way = 0;
+        while (way < num_ways && !((set[way] & LINE_VALID) && (set[way] & TAG_MASK) == tag)) {
+            way++;
+        }
+        bool hit = way < num_ways;
+
+        uint8_t* counter = nullptr;
+        bool predict_miss = false;
+        if (use_predictor) {
+            size_t key = pc ? pc : address >> 12;
+            counter = &predictor[(size_t)((key * 0x9e3779b97f4a7c15ULL) >> 40) % predictor.size()];
+            predict_miss = *counter < 2;
+        }
+
+        uint64_t latency;
+        if (predict_miss) {
+            // Memory is read right away; the tags are checked when the block returns
+            skipped_probes++;
+            memory_bytes += block_size;
+            tag_bytes += probe_bytes();
+            latency = memory_latency;
+            if (hit && (set[way] & LINE_DIRTY)) {
+                // The cached copy is newer than memory and has to be read after all
+                latency += probe_latency + data_latency;
+                data_bytes += block_size;
+            }
+            if (hit) {
+                predicted_miss_hits++;
+            }
+        } else {
+            tag_bytes += probe_bytes();
+            latency = probe_latency;
+            if (organization == DRAM_CACHE_ALLOY) {
+                data_bytes += block_size;  // The data streams with the tag, hit or not
+            } else if (hit) {
+                data_bytes += block_size;
+                latency += data_latency;
+            }
+            if (!hit) {
+                predicted_hit_misses += use_predictor;
+                memory_bytes += block_size;
+                latency += memory_latency;
+            }
+        }
+
+        if (hit) {
+            hits++;
+            if (is_write) {
+                set[way] |= LINE_DIRTY;
+                data_bytes += block_size;
+            }
+            if (organization == DRAM_CACHE_SET_ASSOCIATIVE) {
+                tag_bytes += tag_entry_bytes;  // NRU and dirty bits written back to the tag
+            }
+            reference(set_idx, way);
+        } else {
+            misses++;
+            fill(set_idx, tag, is_write);
+        }
+        if (counter) {
+            *counter = hit ? min(*counter + 1, 3) : max(*counter - 1, 0);
+        }
+        total_latency += latency;
+        return latency;
+    }
+
+    void print_stats(const string& pattern) {
+        int accesses = hits + misses;
+        uint64_t cache_bytes = tag_bytes + data_bytes;
+        cout << "\nDRAM Cache Stats for " << pattern << " ("
+             << (organization == DRAM_CACHE_ALLOY ? "Alloy, direct-mapped" : to_string(num_ways) + "-way tags-in-DRAM")
+             << ", " << num_sets * num_ways * block_size / (1024 * 1024) << " MB"
+             << (use_predictor ? ", MAP-I predictor" : "") << "):\n";
+        cout << "Hits: " << hits << ", Misses: " << misses << ", Hit Rate: " << hits * 100.0 / accesses << "%"
+             << ", Avg Latency: " << (double)total_latency / accesses << "\n";
+        if (use_predictor) {
+            cout << "Skipped Probes: " << skipped_probes << ", Predicted-miss Hits: " << predicted_miss_hits
+                 << ", Predicted-hit Misses: " << predicted_hit_misses << ", Prediction Accuracy: "
+                 << (accesses - predicted_miss_hits - predicted_hit_misses) * 100.0 / accesses << "%\n";
+        }
+        cout << "Tag Bytes: " << tag_bytes << ", Data Bytes: " << data_bytes << ", Tag Share of DRAM-cache Traffic: "
+             << (cache_bytes ? tag_bytes * 100.0 / cache_bytes : 0.0) << "%, Memory Bytes: " << memory_bytes
+             << ", Writebacks: " << writebacks << "\n";
+        cout << "Metadata: " << metadata.size() * sizeof(uint32_t) / 1024 << " KB for "
+             << metadata.size() << " lines\n";
+    }
+};
+
+// Parses a Valgrind Lackey trace (--trace-mem=yes): "I  addr,size" instruction
+// fetches and " L", " S" and " M" data references, with hexadecimal addresses. A
+// modify becomes a load followed by a store, the record cycle counts instructions,
+// and any other line (such as the "==pid==" banner) is skipped.
+vector<trace_record> read_lackey_trace(istream& in) {
+    vector<trace_record> trace;
+    string line;
+    uint64_t instructions = 0;
+    while (getline(in, line)) {
+        char kind;
+        size_t address;
+        unsigned size;
+        if (sscanf(line.c_str(), " %c %zx,%u", &kind, &address, &size) != 3) {
+            continue;
+        }
+        if (kind == 'I') {
+            trace.push_back({address, ACCESS_IFETCH, 0, instructions++, size, HINT_NONE, 0});
+        } else if (kind == 'L' || kind == 'M') {
+            trace.push_back({address, ACCESS_READ, 0, instructions, size, HINT_NONE, 0});
+            if (kind == 'M') {
+                trace.push_back({address, ACCESS_WRITE, (uint8_t)address, instructions, size, HINT_NONE, 0});
+            }
+        } else if (kind == 'S') {
+            trace.push_back({address, ACCESS_WRITE, (uint8_t)address, instructions, size, HINT_NONE, 0});
+        }
+    }
+    return trace;
+}
+
+// Cycle-level timing model for a non-blocking set-associative cache. Hits take
+// hit_latency cycles and misses miss_latency cycles; each outstanding miss holds
+// one of num_mshrs miss status holding registers, later misses to the same block
+// merge into it, and a miss that finds every MSHR busy stalls issue until one frees.
+// Time only advances at record issue cycles and MSHR completions, so idle cycles
+// cost nothing to simulate. An attached dram_model sees the fills and writebacks at
+// their issue cycles, but the miss latency stays miss_latency: DRAM queueing and
+// row-buffer timing do not feed back into it.
+class nonblocking_cache {
+public:
+    struct mshr_entry {
+        size_t block_start;
+        uint64_t ready_at;
+    };
+
+    set_associative_cache& cache;
+    size_t num_mshrs;
+    uint64_t hit_latency, miss_latency;
+    vector<mshr_entry> mshrs;
+    uint64_t now;                       // Issue cycle of the latest access
+    uint64_t accounted_until;           // Occupancy has been recorded up to this cycle
+    vector<uint64_t> occupancy_cycles;  // Cycles spent with k MSHRs busy
+    uint64_t total_latency, stall_cycles;
+    int accesses, primary_misses, secondary_misses, mshr_full_stalls;
+
+    nonblocking_cache(set_associative_cache& cache, size_t num_mshrs,
+                      uint64_t hit_latency, uint64_t miss_latency)
+        : cache(cache) {
+        this->num_mshrs = num_mshrs;
+        this->hit_latency = hit_latency;
+        this->miss_latency = miss_latency;
+        this->now = 0;
+        this->accounted_until = 0;
+        reset_stats();
+    }
+
+    void reset_stats() {
+        occupancy_cycles.assign(num_mshrs + 1, 0);
+        total_latency = 0;
+        stall_cycles = 0;
+        accesses = 0;
+        primary_misses = 0;
+        secondary_misses = 0;
+        mshr_full_stalls = 0;
+    }
+
+    // Advances time to the given cycle, freeing MSHRs whose fills have completed
+    void advance_to(uint64_t cycle) {
+        while (true) {
+            size_t next = mshrs.size();
+            for (size_t i = 0; i < mshrs.size(); ++i) {
+                if (mshrs[i].ready_at <= cycle && (next == mshrs.size() || mshrs[i].ready_at < mshrs[next].ready_at)) {
+                    next = i;
+                }
+            }
+            if (next == mshrs.size()) {
+                break;
+            }
+            uint64_t ready_at = max(mshrs[next].ready_at, accounted_until);
+            occupancy_cycles[mshrs.size()] += ready_at - accounted_until;
+            accounted_until = ready_at;
+            mshrs.erase(mshrs.begin() + next);
+        }
+        if (cycle > accounted_until) {
+            occupancy_cycles[mshrs.size()] += cycle - accounted_until;
+            accounted_until = cycle;
+        }
+    }
+
+    // Issues one record (in order, no earlier than its cycle) and returns its latency
+    uint64_t access(const trace_record& record) {
+        uint64_t issue = max(record.cycle, now);
+        advance_to(issue);
+        if (cache.dram) {
+            cache.dram->advance_to(issue);
+        }
+        if (!is_memory_reference(record.type)) {
+            // Maintenance, fences and context switches take effect at issue and are
+            // not timed as accesses
+            cache.access(record);
+            now = issue;
+            return 0;
+        }
+        size_t block_start = (record.address / cache.block_size) * cache.block_size;
+        accesses++;
+
+        // Secondary miss: the block is already on its way
+        for (const mshr_entry& entry : mshrs) {
+            if (entry.block_start == block_start) {
+                if (record.type == ACCESS_WRITE) {
+                    cache.write_to_cache(record.address, record.value);
+                } else {
+                    cache.read_from_cache(record.address);
+                }
+                secondary_misses++;
+                uint64_t latency = max(hit_latency, entry.ready_at - issue);
+                now = issue;
+                total_latency += latency;
+                return latency;
+            }
+        }
+
+        // Probe first so that a miss stalled on a full MSHR file reaches the cache,
+        // and the DRAM backend, only once an MSHR has freed
+        size_t physical = cache.translator ? cache.translator->translate(record.address) : record.address;
+        bool resident = cache.find_way(cache.extract_index(physical), cache.extract_tag(physical)) != -1;
+        bool posted_store = record.type == ACCESS_WRITE && cache.miss_policy == NO_WRITE_ALLOCATE;
+        uint64_t latency = hit_latency;
+        if (!resident && !posted_store) {
+            // Primary miss: wait for a free MSHR if all are busy
+            primary_misses++;
+            if (mshrs.size() == num_mshrs) {
+                uint64_t earliest = mshrs[0].ready_at;
+                for (const mshr_entry& entry : mshrs) {
+                    earliest = min(earliest, entry.ready_at);
+                }
+                mshr_full_stalls++;
+                stall_cycles += earliest - issue;
+                latency += earliest - issue;
+                issue = earliest;
+                advance_to(issue);
+                if (cache.dram) {
+                    cache.dram->advance_to(issue);
+                }
+            }
+            mshrs.push_back({block_start, issue + miss_latency});
+            latency += miss_latency - hit_latency;
+        }
+        if (record.type == ACCESS_WRITE) {
+            cache.write_to_cache(record.address, record.value);
+        } else {
+            cache.read_from_cache(record.address);
+        }
+        now = issue;
+        total_latency += latency;
+        return latency;
+    }
+
+    void replay(const vector<trace_record>& trace) {
+        for (const trace_record& record : trace) {
+            access(record);
+        }
+        // Let the outstanding misses complete
+        uint64_t last_ready = now;
+        for (const mshr_entry& entry : mshrs) {
+            last_ready = max(last_ready, entry.ready_at);
+        }
+        advance_to(last_ready);
+    }
+
+    void print_stats(const string& pattern) {
+        uint64_t busy_cycles = 0, weighted = 0, all_cycles = 0;
+        for (size_t k = 0; k < occupancy_cycles.size(); ++k) {
+            all_cycles += occupancy_cycles[k];
+            if (k > 0) {
+                busy_cycles += occupancy_cycles[k];
+                weighted += k * occupancy_cycles[k];
+            }
+        }
+        cout << "\nTiming Stats for " << pattern << ": Accesses: " << accesses
+             << ", Primary Misses: " << primary_misses << ", Secondary Misses: " << secondary_misses
+             << ", MSHR-full Stalls: " << mshr_full_stalls << " (" << stall_cycles << " cycles)\n"
+             << "AMAT: " << (accesses ? (double)total_latency / accesses : 0.0) << " cycles"
+             << ", MLP: " << (busy_cycles ? (double)weighted / busy_cycles : 0.0)
+             << ", Cycles: " << all_cycles << "\nMSHR Occupancy:";
+        for (size_t k = 0; k < occupancy_cycles.size(); ++k) {
+            cout << " " << k << ": " << (all_cycles ? occupancy_cycles[k] * 100.0 / all_cycles : 0.0) << "%";
+        }
+        cout << "\n";
+    }
+};
+
+// Page sizes supported by the translation structures
+enum page_size_class { PAGE_4K, PAGE_2M, PAGE_1G };
+
+// Set-associative translation structure (TLB or page-walk cache) built from the same
+// 4-way PLRU cache sets as set_associative_cache. Lines hold tags only; callers
+// fold the page size or page-table level into the tag so entries never alias.
+class translation_cache {
+public:
+    size_t num_sets;
+    vector<cache_set> sets;
+    int hits, misses;
+
+    translation_cache(size_t num_entries) {
+        this->num_sets = max((size_t)1, num_entries / NUM_WAYS);
+        this->sets.resize(num_sets, cache_set(0));
+        this->hits = 0;
+        this->misses = 0;
+    }
+
+    // Looks up a key, updating PLRU state on a hit; does not count statistics
+    bool probe(size_t key) {
+        cache_set& set = sets[(key >> 2) % num_sets];
+        for (int i = 0; i < NUM_WAYS; ++i) {
+            if (set.lines[i].valid && set.lines[i].tag == key) {
+                set.updatePLRU(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void insert(size_t key) {
+        cache_set& set = sets[(key >> 2) % num_sets];
+        int way = -1;
+        for (int i = 0; i < NUM_WAYS && way == -1; ++i) {
+            if (!set.lines[i].valid) {
+                way = i;
+            }
+        }
+        if (way == -1) {
+            way = set.findPLRUVictim();
+        }
+        set.lines[way].valid = true;
+        set.lines[way].tag = key;
+        set.updatePLRU(way);
+    }
+};
+
+// Memory management unit in front of a data cache: L1 and L2 TLBs, a page-walk cache
+// for the upper page-table levels, and a 4-level radix page-table walker (x86-64
+// layout) whose page-table entry reads go through the data cache. Regions can be
+// mapped with 4 KB, 2 MB or 1 GB pages. Page tables live in a reserved area of main
+// memory; tables are allocated there on first use and wrap around when it is full.
+class mmu {
+public:
+    struct page_region {
+        size_t start, end;
+        page_size_class page_class;
+    };
+
+    set_associative_cache& data_cache;
+    translation_cache l1_tlb, l2_tlb, walk_cache;
+    vector<page_region> regions;       // Default is 4 KB pages
+    map<size_t, size_t> table_frames;  // (table prefix, level) -> physical table address
+    size_t table_area_start, table_area_size, next_table;
+    unordered_set<size_t> walk_evicted; // Data blocks displaced by walk references
+    address_translator* translator;     // Optional frame placement (identity mapping otherwise)
+    int translations, walks, walk_cache_hits, walk_references, walk_reference_misses;
+    int walk_evictions, walk_pollution_misses;
+
+    mmu(set_associative_cache& data_cache, size_t l1_entries, size_t l2_entries,
+        size_t walk_cache_entries, size_t table_area_start, size_t table_area_size)
+        : data_cache(data_cache), l1_tlb(l1_entries), l2_tlb(l2_entries), walk_cache(walk_cache_entries) {
+        this->table_area_start = table_area_start;
+        this->table_area_size = table_area_size;
+        this->next_table = 0;
+        this->translator = nullptr;
+        reset_stats();
+    }
+
+    void reset_stats() {
+        translations = 0;
+        walks = 0;
+        walk_cache_hits = 0;
+        walk_references = 0;
+        walk_reference_misses = 0;
+        walk_evictions = 0;
+        walk_pollution_misses = 0;
+        l1_tlb.hits = l1_tlb.misses = 0;
+        l2_tlb.hits = l2_tlb.misses = 0;
+    }
+
+    static size_t page_shift(page_size_class page_class) {
+        return page_class == PAGE_1G ? 30 : page_class == PAGE_2M ? 21 : 12;
+    }
+
+    // Maps [start, start + length) with the given page size
+    void map_region(size_t start, size_t length, page_size_class page_class) {
+        regions.push_back({start, start + length, page_class});
+    }
+
+    page_size_class page_class_of(size_t vaddr) {
+        for (const page_region& region : regions) {
+            if (vaddr >= region.start && vaddr < region.end) {
+                return region.page_class;
+            }
+        }
+        return PAGE_4K;
+    }
+
+    // Physical address of the page table at the given level that covers vaddr
+    size_t table_address(size_t vaddr, int level) {
+        size_t key = (vaddr >> (12 + 9 * level) << 3) | level;
+        map<size_t, size_t>::iterator it = table_frames.find(key);
+        if (it != table_frames.end()) {
+            return it->second;
+        }
+        size_t address = table_area_start + next_table;
+        next_table = (next_table + 4096) % table_area_size;
+        table_frames[key] = address;
+        return address;
+    }
+
+    // Reads one page-table entry through the data cache
+    void walk_reference(size_t vaddr, int level) {
+        size_t index = (vaddr >> (12 + 9 * (level - 1))) & 511;
+        walk_references++;
+        data_cache.read_from_cache(table_address(vaddr, level) + index * 8);
+        if (!data_cache.last_access_hit) {
+            walk_reference_misses++;
+        }
+        if (data_cache.last_evicted_valid) {
+            walk_evictions++;
+            walk_evicted.insert(data_cache.last_evicted_address);
+        }
+    }
+
+    // Walks the page table from the deepest level found in the page-walk cache
+    void walk(size_t vaddr, page_size_class page_class) {
+        int leaf_level = page_class == PAGE_1G ? 3 : page_class == PAGE_2M ? 2 : 1;
+        int level = 4;
+        walks++;
+        for (int cached = leaf_level + 1; cached <= 4; ++cached) {
+            if (walk_cache.probe((vaddr >> (12 + 9 * (cached - 1)) << 2) | (cached - 1))) {
+                walk_cache_hits++;
+                level = cached - 1;
+                break;
+            }
+        }
+        for (; level >= leaf_level; --level) {
+            walk_reference(vaddr, level);
+            if (level > leaf_level) {
+                walk_cache.insert((vaddr >> (12 + 9 * (level - 1)) << 2) | (level - 1));
+            }
+        }
+    }
+
+    // Translates a virtual address; placement comes from the translator if one is
+    // attached (the data cache itself must not have one as well)
+    size_t physical_address(size_t vaddr) {
+        return translator ? translator->translate(vaddr) : vaddr;
+    }
+
+    size_t translate(size_t vaddr) {
+        page_size_class page_class = page_class_of(vaddr);
+        size_t key = (vaddr >> page_shift(page_class) << 2) | page_class;
+        translations++;
+        if (l1_tlb.probe(key)) {
+            l1_tlb.hits++;
+            return physical_address(vaddr);
+        }
+        l1_tlb.misses++;
+        if (l2_tlb.probe(key)) {
+            l2_tlb.hits++;
+        } else {
+            l2_tlb.misses++;
+            walk(vaddr, page_class);
+            l2_tlb.insert(key);
+        }
+        l1_tlb.insert(key);
+        return physical_address(vaddr);
+    }
+
+    // Translates and reads one byte through the data cache
+    uint8_t read(size_t vaddr) {
+        size_t paddr = translate(vaddr);
+        uint8_t value = data_cache.read_from_cache(paddr);
+        if (!data_cache.last_access_hit &&
+            walk_evicted.erase((paddr / data_cache.block_size) * data_cache.block_size)) {
+            walk_pollution_misses++;
+        }
+        return value;
+    }
+
+    void print_stats(const string& pattern) {
+        cout << "\nMMU Stats for " << pattern << ": Translations: " << translations
+             << ", L1 TLB Hits: " << l1_tlb.hits << ", L2 TLB Hits: " << l2_tlb.hits
+             << ", Walks: " << walks << " (" << (translations ? walks * 100.0 / translations : 0.0) << "%)\n"
+             << "Walk Cache Hits: " << walk_cache_hits << ", PTE Reads: " << walk_references
+             << ", PTE Cache Misses: " << walk_reference_misses
+             << ", Data Lines Evicted by Walks: " << walk_evictions
+             << ", Walk-induced Data Misses: " << walk_pollution_misses << "\n";
+    }
+};
+
+// How addresses are spread over the banks of a banked cache
+enum bank_interleaving { BANK_BY_BLOCK, BANK_BY_WORD };
+
+// Banked cache model: accesses are grouped into per-cycle issue bundles of
+// issue_width records, and two accesses of a cycle that map to the same bank
+// conflict; the later one (and the rest of its bundle) moves to the next cycle.
+// A bank conflict is a single bit test against the cycle's busy-bank mask.
+class banked_cache {
+public:
+    set_associative_cache& cache;
+    size_t num_banks, word_size, issue_width;  // num_banks: power of two, at most 64
+    bank_interleaving interleaving;
+    vector<int> bank_accesses;
+    int accesses, bundles, bank_conflicts;
+    uint64_t cycles, stall_cycles;
+
+    banked_cache(set_associative_cache& cache, size_t num_banks, bank_interleaving interleaving,
+                 size_t issue_width, size_t word_size = 8)
+        : cache(cache) {
+        this->num_banks = num_banks;
+        this->interleaving = interleaving;
+        this->issue_width = issue_width;
+        this->word_size = word_size;
+        reset_stats();
+    }
+
+    void reset_stats() {
+        bank_accesses.assign(num_banks, 0);
+        accesses = 0;
+        bundles = 0;
+        bank_conflicts = 0;
+        cycles = 0;
+        stall_cycles = 0;
+    }
+
+    size_t bank_of(size_t address) {
+        size_t unit = interleaving == BANK_BY_BLOCK ? cache.block_size : word_size;
+        return (address / unit) & (num_banks - 1);
+    }
+
+    void replay(const vector<trace_record>& trace) {
+        for (size_t start = 0; start < trace.size(); start += issue_width) {
+            size_t end = min(trace.size(), start + issue_width);
+            uint64_t busy_banks = 0;
+            bundles++;
+            cycles++;
+            for (size_t i = start; i < end; ++i) {
+                const trace_record& record = trace[i];
+                if (!is_memory_reference(record.type)) {
+                    // Maintenance, fences and context switches use no bank port
+                    cache.access(record);
+                    continue;
+                }
+                uint64_t bank_bit = 1ULL << bank_of(record.address);
+                if (busy_banks & bank_bit) {
+                    // Serialize: the conflicting access waits for the next cycle
+                    bank_conflicts++;
+                    stall_cycles++;
+                    cycles++;
+                    busy_banks = 0;
+                }
+                busy_banks |= bank_bit;
+                bank_accesses[bank_of(record.address)]++;
+                accesses++;
+                if (record.type == ACCESS_WRITE) {
+                    cache.write_to_cache(record.address, record.value);
+                } else {
+                    cache.read_from_cache(record.address);
+                }
+            }
+        }
+    }
+
+    void print_stats(const string& pattern) {
+        const char* interleaving_names[] = {"block", "word"};
+        cout << "\nBank Stats for " << pattern << " (" << num_banks << " banks, "
+             << interleaving_names[interleaving] << "-interleaved, " << issue_width << "-wide): "
+             << "Accesses: " << accesses << ", Bundles: " << bundles
+             << ", Bank Conflicts: " << bank_conflicts << ", Stall Cycles: " << stall_cycles
+             << ", Cycles: " << cycles << "\nAccesses per Bank:";
+        for (int count : bank_accesses) {
+            cout << " " << count;
+        }
+        cout << "\n";
+    }
+};
+
+// Implements a direct-mapped cache with column-associative (hash-rehash) lookup.
+// A miss in the primary line probes a second line found by flipping the top index
+// bit; a rehash bit per line marks blocks that live in their alternate location.
+class column_associative_cache : public cache_engine {
+public:
+    size_t num_lines;          // Expected to be a power of two
+    vector<cache_line> lines;  // Tags hold the full block number
+    vector<bool> rehash_bits;  // Set when a line holds a block from its rehash location
+    int first_probe_hits, second_probe_hits;
+
+    column_associative_cache(size_t block_size, size_t cache_size, main_memory& main_mem)
+        : cache_engine(block_size, main_mem) {
+        this->num_lines = cache_size / block_size;
+        this->first_probe_hits = 0;
+        this->second_probe_hits = 0;
+        this->lines.resize(num_lines, cache_line(block_size));
+        this->rehash_bits.resize(num_lines, false);
+    }
+
+    void reset_cache_stats() override {
+        cache_engine::reset_cache_stats();
+        first_probe_hits = 0;
+        second_probe_hits = 0;
+    }
+
+    // Alternate location used by the second probe
+    size_t rehash_index(size_t index) {
+        return index ^ (num_lines >> 1);
+    }
+
+    // Loads a memory block into the given line
+    void load_block_from_memory(size_t block, size_t index) {
+        size_t block_start = block * block_size;
+
+        lines[index].valid = true;
+        lines[index].tag = block;
+        for (size_t i = 0; i < block_size; i++) {
+            lines[index].cache_data[i] = memory.memory_array[block_start + i];
+        }
+    }
+
+    // Probes the primary line, then the rehashed line, swapping on a second-probe hit
+    uint8_t read_from_cache(size_t address) override {
+        size_t block = address / block_size;
+        size_t block_offset = address % block_size;
+        size_t index = block % num_lines;
+
+        total_accesses++;
+        if (lines[index].valid && lines[index].tag == block) {
+            cache_hits++;
+            first_probe_hits++;
+            return lines[index].cache_data[block_offset];
+        }
+
+        // A rehashed block in the primary line is replaced without a second probe
+        if (rehash_bits[index]) {
+            cache_misses++;
+            load_block_from_memory(block, index);
+            rehash_bits[index] = false;
+            return lines[index].cache_data[block_offset];
+        }
+
+        size_t alt_index = rehash_index(index);
+        if (lines[alt_index].valid && lines[alt_index].tag == block) {
+            // Second-probe hit: move the block home and demote the displaced one
+            cache_hits++;
+            second_probe_hits++;
+            swap(lines[index], lines[alt_index]);
+            rehash_bits[index] = false;
+            rehash_bits[alt_index] = lines[alt_index].valid;
+            return lines[index].cache_data[block_offset];
+        }
+
+        // Miss on both probes: the alternate line is evicted, the primary block
+        // moves there and the new block is loaded into the primary line
+        cache_misses++;
+        swap(lines[index], lines[alt_index]);
+        rehash_bits[alt_index] = lines[alt_index].valid;
+        load_block_from_memory(block, index);
+        rehash_bits[index] = false;
+        return lines[index].cache_data[block_offset];
+    }
+
+    void print_cache_stats(const string& pattern) override {
+        cache_engine::print_cache_stats(pattern);
+        cout << "First-probe Hits: " << first_probe_hits
+             << ", Second-probe Hits: " << second_probe_hits << "\n";
+    }
+};
+
+// Implements a zcache: every way is indexed by its own hash function, so a block
+// that is displaced from one way can be relocated to its position in another way.
+// A miss walks these relocations breadth-first (up to max_candidates lines) and
+// evicts the least recently used candidate, giving far more replacement choices
+// than the physical way count.
+class zcache : public cache_engine {
+public:
+    // Replacement candidate discovered by the walk; parent is the candidate whose
+    // block would move into this line (-1 for the first-level lines)
+    struct candidate {
+        size_t slot;
+        int parent;
+    };
+
+    size_t num_ways, lines_per_way, max_candidates;
+    vector<cache_line> lines;      // lines[way * lines_per_way + index], tags hold the block number
+    vector<uint64_t> last_access;  // LRU timestamp per line
+    uint64_t access_clock;
+    size_t candidates_examined, relocations;
+    vector<candidate> candidates;  // Scratch list reused across misses
+
+    zcache(size_t block_size, size_t cache_size, main_memory& main_mem,
+           size_t num_ways = NUM_WAYS, size_t max_candidates = 52)
+        : cache_engine(block_size, main_mem) {
+        this->num_ways = num_ways;
+        this->lines_per_way = cache_size / (num_ways * block_size);
+        this->max_candidates = max_candidates;
+        this->access_clock = 0;
+        this->candidates_examined = 0;
+        this->relocations = 0;
+        this->lines.resize(num_ways * lines_per_way, cache_line(block_size));
+        this->last_access.resize(num_ways * lines_per_way, 0);
+        this->candidates.reserve(max_candidates);
+    }
+
+    void reset_cache_stats() override {
+        cache_engine::reset_cache_stats();
+        candidates_examined = 0;
+        relocations = 0;
+    }
+
+    // Line of the given block in the given way, using a different hash per way
+    size_t hash_slot(size_t block, size_t way) {
+        uint64_t h = (uint64_t)block * 0x9E3779B97F4A7C15ULL + (way + 1) * 0xC2B2AE3D27D4EB4FULL;
+        h ^= h >> 29;
+        h *= 0xBF58476D1CE4E5B9ULL;
+        h ^= h >> 32;
+        return way * lines_per_way + h % lines_per_way;
+    }
+
+    // Loads a memory block into the given line
+    void load_block_from_memory(size_t block, size_t slot) {
+        size_t block_start = block * block_size;
+
+        lines[slot].valid = true;
+        lines[slot].tag = block;
+        for (size_t i = 0; i < block_size; i++) {
+            lines[slot].cache_data[i] = memory.memory_array[block_start + i];
+        }
+    }
+
+    bool is_candidate(size_t slot) {
+        for (const candidate& c : candidates) {
+            if (c.slot == slot) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Breadth-first walk over relocation candidates; returns the chosen victim
+    size_t find_victim_candidate(size_t block) {
+        candidates.clear();
+        for (size_t way = 0; way < num_ways; ++way) {
+            candidates.push_back({hash_slot(block, way), -1});
+        }
+
+        size_t victim = 0;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            const cache_line& line = lines[candidates[i].slot];
+            if (!line.valid) {
+                // An empty line ends the walk: nothing needs to be evicted
+                victim = i;
+                break;
+            }
+            if (last_access[candidates[i].slot] < last_access[candidates[victim].slot]) {
+                victim = i;
+            }
 
-    cache_set(size_t block_size) {
-        plru_bits.resize(3, false);
-        lines.resize(NUM_WAYS, cache_line(block_size));
+            size_t line_way = candidates[i].slot / lines_per_way;
+            for (size_t way = 0; way < num_ways && candidates.size() < max_candidates; ++way) {
+                size_t slot = hash_slot(line.tag, way);
+                if (way != line_way && !is_candidate(slot)) {
+                    candidates.push_back({slot, (int)i});
+                }
+            }
+        }
+        candidates_examined += candidates.size();
+        return victim;
     }
 
-    // Updates PLRU bits based on the accessed way
-    void updatePLRU(int accessedWay) {
-        plru_bits[0] = accessedWay >= 2;
-        plru_bits[1] = accessedWay % 2;
-        plru_bits[2] = (accessedWay / 2) % 2;
+    uint8_t read_from_cache(size_t address) override {
+        size_t block = address / block_size;
+        size_t block_offset = address % block_size;
+
+        total_accesses++;
+        access_clock++;
+        for (size_t way = 0; way < num_ways; ++way) {
+            size_t slot = hash_slot(block, way);
+            if (lines[slot].valid && lines[slot].tag == block) {
+                cache_hits++;
+                last_access[slot] = access_clock;
+                return lines[slot].cache_data[block_offset];
+            }
+        }
+
+        // Cache miss: evict the victim and shift each block on its path one step
+        // towards it, which frees a first-level line for the new block
+        cache_misses++;
+        size_t victim = find_victim_candidate(block);
+        while (candidates[victim].parent != -1) {
+            size_t parent = candidates[victim].parent;
+            swap(lines[candidates[victim].slot], lines[candidates[parent].slot]);
+            last_access[candidates[victim].slot] = last_access[candidates[parent].slot];
+            relocations++;
+            victim = parent;
+        }
+        size_t slot = candidates[victim].slot;
+        load_block_from_memory(block, slot);
+        last_access[slot] = access_clock;
+        return lines[slot].cache_data[block_offset];
     }
 
-    // Determines which cache way should be replaced using PLRU policy
-    int findPLRUVictim() {
-        return (plru_bits[0] ? (plru_bits[2] ? 3 : 2) : (plru_bits[1] ? 1 : 0));
+    void print_cache_stats(const string& pattern) override {
+        cache_engine::print_cache_stats(pattern);
+        double misses = cache_misses ? cache_misses : 1;
+        cout << "Avg Candidates/Miss: " << candidates_examined / misses
+             << ", Avg Relocations/Miss: " << relocations / misses << "\n";
     }
 };
 
-// Implements a 4-way set-associative cache with PLRU replacement policy
-class set_associative_cache {
+// Implements a fully associative cache whose lookup cost does not grow with capacity.
+// Tags are found through an open-addressing hash table (linear probing) that maps a
+// block number to its line, and replacement uses an intrusive LRU list over lines,
+// so hits, misses and evictions are all O(1).
+class fully_associative_cache : public cache_engine {
 public:
-    size_t num_sets, block_size;
-    vector<cache_set> sets;
-    int cache_hits, cache_misses, total_accesses;
-    map<string, double> hit_rates;
-    main_memory& memory; // Reference to main memory
-    
-    set_associative_cache(size_t block_size, size_t cache_size, main_memory& main_mem)
-        : memory(main_mem) {
-        this->block_size = block_size;
-        this->num_sets = cache_size / (NUM_WAYS * block_size);
-        this->cache_hits = 0;
-        this->cache_misses = 0;
-        this->total_accesses = 0;
-        this->sets.resize(num_sets, cache_set(block_size));
+    size_t num_lines, table_mask;
+    vector<cache_line> lines;         // Tags hold the block number
+    vector<int> hash_table;           // Line number per bucket, -1 when empty
+    vector<int> lru_prev, lru_next;   // Intrusive LRU list, head is most recently used
+    int lru_head, lru_tail;
+    size_t lines_used;
+
+    fully_associative_cache(size_t block_size, size_t cache_size, main_memory& main_mem)
+        : cache_engine(block_size, main_mem) {
+        this->num_lines = cache_size / block_size;
+        this->lines_used = 0;
+        this->lru_head = -1;
+        this->lru_tail = -1;
+        this->lines.resize(num_lines, cache_line(block_size));
+        this->lru_prev.resize(num_lines, -1);
+        this->lru_next.resize(num_lines, -1);
+
+        // Keep the load factor at or below 50% so probe sequences stay short
+        size_t table_size = 1;
+        while (table_size < 2 * num_lines) {
+            table_size <<= 1;
+        }
+        this->table_mask = table_size - 1;
+        this->hash_table.resize(table_size, -1);
     }
 
-    void reset_cache_stats() {
-        cache_hits = 0;
-        cache_misses = 0;
+    size_t home_bucket(size_t block) {
+        uint64_t h = (uint64_t)block * 0x9E3779B97F4A7C15ULL;
+        return (h ^ (h >> 32)) & table_mask;
     }
 
-    // Extracts the tag from the given memory address
-    size_t extract_tag(size_t address) {
-        return address / (block_size * num_sets);
+    // Returns the line holding the block, or -1 if it is not cached
+    int find_line(size_t block) {
+        for (size_t b = home_bucket(block); hash_table[b] != -1; b = (b + 1) & table_mask) {
+            if (lines[hash_table[b]].tag == block) {
+                return hash_table[b];
+            }
+        }
+        return -1;
     }
 
-    // Extracts the index (set number) from the given memory address
-    size_t extract_index(size_t address) {
-        return (address >> (size_t)log2(block_size)) % num_sets;
+    void table_insert(size_t block, int line) {
+        size_t b = home_bucket(block);
+        while (hash_table[b] != -1) {
+            b = (b + 1) & table_mask;
+        }
+        hash_table[b] = line;
     }
 
-    // Extracts the block offset from the given memory address
-    size_t extract_block_offset(size_t address) {
-        return address % block_size;
+    // Removes a block with backward-shift deletion, so no tombstones accumulate
+    void table_erase(size_t block) {
+        size_t hole = home_bucket(block);
+        while (lines[hash_table[hole]].tag != block) {
+            hole = (hole + 1) & table_mask;
+        }
+        for (size_t b = (hole + 1) & table_mask; hash_table[b] != -1; b = (b + 1) & table_mask) {
+            size_t home = home_bucket(lines[hash_table[b]].tag);
+            // An entry may fill the hole only if its home is not cyclically in (hole, b]
+            bool home_after_hole = (b > hole) ? (home > hole && home <= b)
+                                              : (home > hole || home <= b);
+            if (!home_after_hole) {
+                hash_table[hole] = hash_table[b];
+                hole = b;
+            }
+        }
+        hash_table[hole] = -1;
     }
 
-    // Loads a memory block into the cache
-    void load_block_from_memory(size_t address, int way) {
-        size_t set_idx = extract_index(address);
-        size_t tag = extract_tag(address);
-        size_t block_start = (address / block_size) * block_size;
-        
-        sets[set_idx].lines[way].valid = true;
-        sets[set_idx].lines[way].tag = tag;
+    void lru_unlink(int line) {
+        if (lru_prev[line] != -1) lru_next[lru_prev[line]] = lru_next[line];
+        else lru_head = lru_next[line];
+        if (lru_next[line] != -1) lru_prev[lru_next[line]] = lru_prev[line];
+        else lru_tail = lru_prev[line];
+    }
+
+    void lru_push_front(int line) {
+        lru_prev[line] = -1;
+        lru_next[line] = lru_head;
+        if (lru_head != -1) lru_prev[lru_head] = line;
+        lru_head = line;
+        if (lru_tail == -1) lru_tail = line;
+    }
+
+    // Loads a memory block into the given line
+    void load_block_from_memory(size_t block, int line) {
+        size_t block_start = block * block_size;
+
+        lines[line].valid = true;
+        lines[line].tag = block;
         for (size_t i = 0; i < block_size; i++) {
-            sets[set_idx].lines[way].cache_data[i] = memory.memory_array[block_start + i];
+            lines[line].cache_data[i] = memory.memory_array[block_start + i];
         }
     }
 
-    // Preloads blocks into the cache to prevent cold misses
-    void preload_cache(size_t start_address, size_t num_blocks) {
-        for (size_t i = 0; i < num_blocks; ++i) {
-            size_t address = start_address + i * block_size;
-            size_t set_idx = extract_index(address);
-            int evictWay = -1;
+    uint8_t read_from_cache(size_t address) override {
+        size_t block = address / block_size;
+        size_t block_offset = address % block_size;
 
-            // Check for an empty line to preload
-            for (int j = 0; j < NUM_WAYS; ++j) {
-                if (!sets[set_idx].lines[j].valid) {
-                    evictWay = j;
-                    break;
+        total_accesses++;
+        int line = find_line(block);
+        if (line != -1) {
+            cache_hits++;
+            lru_unlink(line);
+            lru_push_front(line);
+            return lines[line].cache_data[block_offset];
+        }
+
+        // Cache miss: use a free line while there is one, otherwise evict the LRU line
+        cache_misses++;
+        if (lines_used < num_lines) {
+            line = lines_used++;
+        } else {
+            line = lru_tail;
+            lru_unlink(line);
+            table_erase(lines[line].tag);
+        }
+        load_block_from_memory(block, line);
+        table_insert(block, line);
+        lru_push_front(line);
+        return lines[line].cache_data[block_offset];
+    }
+};
+
+// Implements a set-associative cache tuned for wide sets (up to 64 ways). Each set's
+// tags are a contiguous 32-bit array compared 16 (AVX-512) or 8 (AVX2) at a time, and
+// valid bits are a per-set mask. Power-of-two way counts use a PLRU tree packed into
+// one 64-bit word per set; other way counts fall back to bit-PLRU (MRU bits).
+// Tags are 32 bits wide, so main memory may span at most 2^32 tags' worth of sets.
+class wide_set_associative_cache : public cache_engine {
+public:
+    size_t num_sets, num_ways, tag_stride;
+    bool tree_plru;
+    uint64_t way_mask;                   // One bit per physical way
+    vector<uint32_t> tags;               // tags[set * tag_stride + way], padded to 16 ways
+    vector<uint64_t> valid_masks;        // Valid bit per way
+    vector<uint64_t> plru_state;         // Tree nodes (bit n = node n) or MRU bits
+    vector<uint64_t> path_masks, path_values;  // Tree nodes touched by each way and their new values
+    vector<uint8_t> data;                // data[(set * num_ways + way) * block_size]
+
+    wide_set_associative_cache(size_t block_size, size_t cache_size, main_memory& main_mem, size_t num_ways)
+        : cache_engine(block_size, main_mem) {
+        // Way masks and the PLRU word are 64 bits; tags must fit the 32-bit arrays
+        assert(num_ways >= 1 && num_ways <= 64);
+        this->num_ways = num_ways;
+        this->num_sets = cache_size / (num_ways * block_size);
+        assert(main_mem.size / (block_size * num_sets) <= ((size_t)1 << 32));
+        this->tag_stride = (num_ways + 15) / 16 * 16;
+        this->tree_plru = (num_ways & (num_ways - 1)) == 0;
+        this->way_mask = num_ways == 64 ? ~0ULL : (1ULL << num_ways) - 1;
+        this->tags.resize(num_sets * tag_stride, 0);
+        this->valid_masks.resize(num_sets, 0);
+        this->plru_state.resize(num_sets, 0);
+        this->data.resize(num_sets * num_ways * block_size, 0);
+
+        // Precompute, for every way, the tree nodes on its root-to-leaf path and the
+        // values that point them away from it, so an update is a single masked merge
+        if (tree_plru) {
+            path_masks.resize(num_ways, 0);
+            path_values.resize(num_ways, 0);
+            for (size_t way = 0; way < num_ways; ++way) {
+                size_t node = 1;
+                for (size_t level = num_ways >> 1; level > 0; level >>= 1) {
+                    bool right = (way & level) != 0;
+                    path_masks[way] |= 1ULL << node;
+                    if (!right) {
+                        path_values[way] |= 1ULL << node;
+                    }
+                    node = node * 2 + right;
                 }
             }
+        }
+    }
 
-            // If no empty line, find a victim using PLRU
-            if (evictWay == -1) {
-                evictWay = sets[set_idx].findPLRUVictim();
-            }
+    static const char* simd_path() {
+#if defined(__AVX512F__)
+        return "AVX-512";
+#elif defined(__AVX2__)
+        return "AVX2";
+#else
+        return "scalar";
+#endif
+    }
 
-            load_block_from_memory(address, evictWay);
-            sets[set_idx].updatePLRU(evictWay);
-        }
+    // Extracts the tag from the given memory address
+    uint32_t extract_tag(size_t address) {
+        return (uint32_t)(address / (block_size * num_sets));
     }
 
-    // Reads data from the cache and applies PLRU replacement if needed
-    uint8_t read_from_cache(size_t address) {
-        size_t set_idx = extract_index(address);
-        size_t tag = extract_tag(address);
-        size_t block_offset = extract_block_offset(address);
+    // Extracts the index (set number) from the given memory address
+    size_t extract_index(size_t address) {
+        return (address / block_size) % num_sets;
+    }
 
-        total_accesses++;
-        for (int i = 0; i < NUM_WAYS; ++i) {
-            if (sets[set_idx].lines[i].valid && sets[set_idx].lines[i].tag == tag) {
-                cache_hits++;
-                sets[set_idx].updatePLRU(i);
-                return sets[set_idx].lines[i].cache_data[block_offset];
+    // Returns a bit mask of the valid ways whose tag matches
+    uint64_t match_ways(size_t set_idx, uint32_t tag) {
+        const uint32_t* set_tags = &tags[set_idx * tag_stride];
+        uint64_t matches = 0;
+#if defined(__AVX512F__)
+        __m512i key = _mm512_set1_epi32((int)tag);
+        for (size_t way = 0; way < num_ways; way += 16) {
+            __m512i chunk = _mm512_loadu_si512((const void*)(set_tags + way));
+            matches |= (uint64_t)_mm512_cmpeq_epi32_mask(chunk, key) << way;
+        }
+#elif defined(__AVX2__)
+        __m256i key = _mm256_set1_epi32((int)tag);
+        for (size_t way = 0; way < num_ways; way += 8) {
+            __m256i chunk = _mm256_loadu_si256((const __m256i*)(set_tags + way));
+            __m256i equal = _mm256_cmpeq_epi32(chunk, key);
+            matches |= (uint64_t)(uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(equal)) << way;
+        }
+#else
+        for (size_t way = 0; way < num_ways; ++way) {
+            if (set_tags[way] == tag) {
+                matches |= 1ULL << way;
             }
         }
+#endif
+        return matches & valid_masks[set_idx];
+    }
 
-        // Cache miss: find a victim and load block from memory
-        cache_misses++;
-        int evictWay = -1;
-        for (int i = 0; i < NUM_WAYS; ++i) {
-            if (!sets[set_idx].lines[i].valid) {
-                evictWay = i;
-                break;
+    void updatePLRU(size_t set_idx, size_t way) {
+        uint64_t& state = plru_state[set_idx];
+        if (tree_plru) {
+            state = (state & ~path_masks[way]) | path_values[way];
+        } else {
+            // Bit-PLRU: once every way is marked recently used, keep only this one
+            state |= 1ULL << way;
+            if ((state & way_mask) == way_mask) {
+                state = 1ULL << way;
             }
         }
-        if (evictWay == -1) {
-            evictWay = sets[set_idx].findPLRUVictim();
+    }
+
+    size_t findPLRUVictim(size_t set_idx) {
+        uint64_t state = plru_state[set_idx];
+        if (tree_plru) {
+            size_t node = 1;
+            while (node < num_ways) {
+                node = node * 2 + ((state >> node) & 1);
+            }
+            return node - num_ways;
         }
-        load_block_from_memory(address, evictWay);
-        sets[set_idx].updatePLRU(evictWay);
-        return sets[set_idx].lines[evictWay].cache_data[block_offset];
+        return __builtin_ctzll(~state & way_mask);
     }
 
-    // Prints cache performance statistics
-    void print_cache_stats(const string& pattern) {
-        double hit_rate = (cache_hits * 100.0) / (cache_hits + cache_misses);
-        hit_rates[pattern] = hit_rate;
-        cout << "\nCache Stats for " << pattern << ": "
-             << "Hits: " << cache_hits << ", Misses: " << cache_misses
-             << ", Hit Rate: " << hit_rate << "%\n";
+    // Loads a memory block into the cache
+    void load_block_from_memory(size_t address, size_t way) {
+        size_t set_idx = extract_index(address);
+        size_t block_start = (address / block_size) * block_size;
+
+        tags[set_idx * tag_stride + way] = extract_tag(address);
+        valid_masks[set_idx] |= 1ULL << way;
+        for (size_t i = 0; i < block_size; i++) {
+            data[(set_idx * num_ways + way) * block_size + i] = memory.memory_array[block_start + i];
+        }
+    }
+
+    uint8_t read_from_cache(size_t address) override {
+        size_t set_idx = extract_index(address);
+        size_t block_offset = address % block_size;
+
+        total_accesses++;
+        uint64_t matches = match_ways(set_idx, extract_tag(address));
+        size_t way;
+        if (matches) {
+            cache_hits++;
+            way = __builtin_ctzll(matches);
+        } else {
+            // Cache miss: fill an invalid way if there is one, otherwise evict the PLRU way
+            cache_misses++;
+            uint64_t invalid = ~valid_masks[set_idx] & way_mask;
+            way = invalid ? __builtin_ctzll(invalid) : findPLRUVictim(set_idx);
+            load_block_from_memory(address, way);
+        }
+        updatePLRU(set_idx, way);
+        return data[(set_idx * num_ways + way) * block_size + block_offset];
     }
 };
 
@@ -214,6 +4265,38 @@ public:
         return addresses;
     }
 
+    // Function to turn an address pattern into trace records of one access type
+    static vector<trace_record> generate_trace(const vector<size_t>& addresses, access_type type) {
+        vector<trace_record> trace;
+        for (size_t addr : addresses) {
+            trace.push_back({addr, type, (uint8_t)addr, 0, 1, HINT_NONE, 0});
+        }
+        return trace;
+    }
+
+    // Function to interleave per-process traces round-robin, running each process for
+    // quantum references before a context-switch marker hands over to the next one.
+    // Process i runs as ASID i + 1.
+    static vector<trace_record> schedule_processes(const vector<vector<trace_record>>& processes, size_t quantum) {
+        vector<trace_record> trace;
+        vector<size_t> next(processes.size(), 0);
+        for (bool active = true; active;) {
+            active = false;
+            for (size_t p = 0; p < processes.size(); ++p) {
+                if (next[p] == processes[p].size()) {
+                    continue;
+                }
+                trace.push_back({0, ACCESS_CONTEXT_SWITCH, 0, 0, 0, HINT_NONE, (uint16_t)(p + 1)});
+                for (size_t n = 0; n < quantum && next[p] < processes[p].size(); ++n) {
+                    trace.push_back(processes[p][next[p]++]);
+                    trace.back().asid = (uint16_t)(p + 1);
+                }
+                active = true;
+            }
+        }
+        return trace;
+    }
+
     // Function to generate strided access pattern
     static vector<size_t> generate_strided_access(size_t start, size_t stride, size_t count) {
         vector<size_t> addresses;
@@ -224,6 +4307,25 @@ public:
     }
 };
 
+// Replays each access pattern on a cache organization and prints its statistics
+void run_access_patterns(cache_engine& cache, const vector<pair<string, vector<size_t>>>& patterns) {
+    int overall_hits = 0;
+    int overall_misses = 0;
+
+    for (const auto& pattern : patterns) {
+        cache.reset_cache_stats();
+        for (size_t addr : pattern.second) {
+            cache.read_from_cache(addr);
+        }
+        cache.print_cache_stats(pattern.first);
+        overall_hits += cache.cache_hits;
+        overall_misses += cache.cache_misses;
+    }
+
+    double overall_hit_rate = (overall_hits * 100.0) / (overall_hits + overall_misses);
+    cout << "\nOverall Hit Rate: " << overall_hit_rate << "%\n";
+}
+
 int main() {
     size_t memory_size = 65536, cache_size = 8192, block_size = 64;
     main_memory memory(memory_size);
@@ -279,5 +4381,571 @@ int main() {
     double overall_hit_rate = (overall_hits * 100.0) / (overall_hits + overall_misses);
     cout << "\nOverall Hit Rate: " << overall_hit_rate << "%\n";
 
+    // Compare cache organizations of the same capacity, all starting cold. The last
+    // two patterns stress placement: pairs of blocks a cache size apart share a
+    // direct-mapped line, and a random walk over twice the capacity keeps every set
+    // full, which is where rehash probes and relocation walks come into play.
+    vector<size_t> conflict_addresses = TestAccessPatterns::generate_round_robin_access(
+        {0, cache_size, 64, cache_size + 64, 128, cache_size + 128}, 400);
+    vector<size_t> oversubscribed_addresses;
+    mt19937 oversubscribed_gen(7);
+    for (size_t i = 0; i < 2000; ++i) {
+        oversubscribed_addresses.push_back(oversubscribed_gen() % (2 * cache_size / block_size) * block_size);
+    }
+    vector<pair<string, vector<size_t>>> patterns = {
+        {"Sequential Access", sequential_addresses},
+        {"Round Robin Access", round_robin_addresses},
+        {"Random Access", random_addresses},
+        {"Strided Access", strided_addresses},
+        {"Conflicting Blocks", conflict_addresses},
+        {"Oversubscribed Random", oversubscribed_addresses}
+    };
+
+    cout << "\n--- 4-Way PLRU (cold) ---";
+    set_associative_cache plru_cache(block_size, cache_size, memory);
+    run_access_patterns(plru_cache, patterns);
+
+    cout << "\n--- Column-Associative ---";
+    column_associative_cache column_cache(block_size, cache_size, memory);
+    run_access_patterns(column_cache, patterns);
+
+    cout << "\n--- ZCache (4 ways, 52 candidates) ---";
+    zcache z_cache(block_size, cache_size, memory);
+    run_access_patterns(z_cache, patterns);
+
+    cout << "\n--- Fully Associative (hashed lookup, LRU) ---";
+    fully_associative_cache fa_cache(block_size, cache_size, memory);
+    run_access_patterns(fa_cache, patterns);
+
+    // Store-heavy pattern: write a buffer twice the cache size, then read it back
+    cout << "\n--- Write Policies (store-heavy pattern) ---";
+    const char* hit_policy_names[] = {"Write-Back", "Write-Through"};
+    const char* miss_policy_names[] = {"Write-Allocate", "No-Write-Allocate"};
+    vector<size_t> store_addresses = TestAccessPatterns::generate_strided_access(0, 8, 2 * cache_size / 8);
+    for (int h = WRITE_BACK; h <= WRITE_THROUGH; ++h) {
+        for (int m = WRITE_ALLOCATE; m <= NO_WRITE_ALLOCATE; ++m) {
+            set_associative_cache write_cache(block_size, cache_size, memory,
+                                              (write_hit_policy)h, (write_miss_policy)m);
+            for (size_t addr : store_addresses) {
+                write_cache.write_to_cache(addr, memory.memory_array[addr]);
+            }
+            for (size_t addr : store_addresses) {
+                write_cache.read_from_cache(addr);
+            }
+            write_cache.print_cache_stats(string(hit_policy_names[h]) + " / " + miss_policy_names[m]);
+        }
+    }
+
+    // Same stores through an 8-entry coalescing write buffer
+    cout << "\n--- Write-Through / No-Write-Allocate with Coalescing Write Buffer ---";
+    set_associative_cache buffered_cache(block_size, cache_size, memory, WRITE_THROUGH, NO_WRITE_ALLOCATE);
+    write_buffer store_buffer(block_size, 8, memory);
+    buffered_cache.write_buf = &store_buffer;
+    for (size_t addr : store_addresses) {
+        buffered_cache.write_to_cache(addr, memory.memory_array[addr]);
+    }
+    for (size_t addr : store_addresses) {
+        buffered_cache.read_from_cache(addr);
+    }
+    store_buffer.drain_all();
+    buffered_cache.print_cache_stats("Buffered Stores");
+    store_buffer.print_stats();
+
+    // Three-level hierarchy under each inclusion policy on a mixed load/store trace
+    cout << "\n--- L1/L2/L3 Hierarchy (2 KB / 8 KB / 32 KB) ---";
+    vector<trace_record> mixed_trace = TestAccessPatterns::generate_trace(
+        TestAccessPatterns::generate_random_access(20000, memory_size), ACCESS_READ);
+    for (size_t i = 0; i < mixed_trace.size(); i += 3) {
+        mixed_trace[i].type = ACCESS_WRITE;
+        mixed_trace[i].value = memory.memory_array[mixed_trace[i].address];
+    }
+    for (int p = INCLUSIVE; p <= NINE; ++p) {
+        set_associative_cache l1(block_size, 2048, memory), l2(block_size, 8192, memory), l3(block_size, 32768, memory);
+        cache_hierarchy hierarchy({&l1, &l2, &l3}, (inclusion_policy)p);
+        hierarchy.replay(mixed_trace);
+        hierarchy.print_stats("Random Load/Store");
+
+        // Batching must not change the results: replay one reference per batch
+        set_associative_cache u1(block_size, 2048, memory), u2(block_size, 8192, memory), u3(block_size, 32768, memory);
+        cache_hierarchy unbatched({&u1, &u2, &u3}, (inclusion_policy)p, 1);
+        unbatched.replay(mixed_trace);
+        bool same = hierarchy.level_hits == unbatched.level_hits && hierarchy.level_misses == unbatched.level_misses &&
+                    hierarchy.memory_reads == unbatched.memory_reads &&
+                    hierarchy.memory_writebacks == unbatched.memory_writebacks &&
+                    hierarchy.back_invalidations == unbatched.back_invalidations;
+        cout << "Batch of " << hierarchy.batch_size << " vs 1: " << (same ? "identical" : "DIFFERENT") << "\n";
+    }
+
+    // Demand-only versus next-line and stride prefetching on the same patterns
+    vector<size_t> scan_addresses = TestAccessPatterns::generate_strided_access(0, 8, 4096);
+    vector<size_t> stride_addresses = TestAccessPatterns::generate_strided_access(4096, 192, 256);
+    next_line_prefetcher next_line(block_size, 2);
+    stride_prefetcher stride(64, 8);
+    prefetcher* prefetchers[] = {nullptr, &next_line, &stride};
+    const char* prefetcher_names[] = {"No Prefetching", "Next-Line (degree 2)", "Stride RPT (degree 8)"};
+    for (int i = 0; i < 3; ++i) {
+        cout << "\n--- " << prefetcher_names[i] << " ---";
+        set_associative_cache prefetch_cache(block_size, cache_size, memory);
+        prefetch_cache.pf = prefetchers[i];
+        prefetch_cache.prefetch_latency = 4;
+        for (size_t addr : scan_addresses) {
+            prefetch_cache.read_from_cache(addr, 0x400);
+        }
+        prefetch_cache.print_cache_stats("Sequential Scan");
+        prefetch_cache.reset_cache_stats();
+        for (size_t addr : stride_addresses) {
+            prefetch_cache.read_from_cache(addr, 0x404);
+        }
+        prefetch_cache.print_cache_stats("192-Byte Stride");
+    }
+
+    // Irregular but repeating pointer-chasing sequence with a correlation prefetcher
+    vector<size_t> chase_blocks;
+    for (size_t i = 0; i < 256; ++i) {
+        chase_blocks.push_back((i * 97) % 512 * block_size);
+    }
+    vector<size_t> chase_addresses = TestAccessPatterns::generate_round_robin_access(chase_blocks, 4 * chase_blocks.size());
+    markov_prefetcher markov(block_size, 1024, 512, 4);
+    prefetcher* chase_prefetchers[] = {nullptr, &next_line, &markov};
+    const char* chase_names[] = {"No Prefetching", "Next-Line (degree 2)", "Markov GHB (degree 4)"};
+    for (int i = 0; i < 3; ++i) {
+        cout << "\n--- Pointer Chase: " << chase_names[i] << " ---";
+        set_associative_cache chase_cache(block_size, cache_size, memory);
+        chase_cache.pf = chase_prefetchers[i];
+        for (size_t addr : chase_addresses) {
+            chase_cache.read_from_cache(addr);
+        }
+        chase_cache.print_cache_stats("Pointer Chase");
+    }
+    markov.print_stats();
+
+    // Two interleaved sequential streams served by four 4-deep stream buffers
+    cout << "\n--- Stream Buffers (4 x 4 blocks) ---";
+    vector<size_t> interleaved_addresses;
+    for (size_t i = 0; i < 2048; ++i) {
+        interleaved_addresses.push_back(i * 8);
+        interleaved_addresses.push_back(32768 + i * 8);
+    }
+    set_associative_cache stream_cache(block_size, cache_size, memory);
+    stream_buffer_unit stream_unit(block_size, 4, 4, memory_size);
+    dram_model stream_dram(dram_config(), block_size);
+    stream_cache.stream_bufs = &stream_unit;
+    stream_cache.dram = &stream_dram;
+    stream_unit.dram = &stream_dram;
+    for (size_t i = 0; i < interleaved_addresses.size(); ++i) {
+        stream_dram.advance_to(16 * i);
+        stream_cache.read_from_cache(interleaved_addresses[i]);
+    }
+    stream_dram.drain();
+    stream_cache.print_cache_stats("Interleaved Streams");
+    stream_unit.print_stats();
+    stream_dram.print_stats();
+
+    // Non-blocking cache: one access every 2 cycles, 4-cycle hits, 100-cycle misses
+    cout << "\n--- Non-blocking Cache with MSHRs ---";
+    vector<trace_record> timed_trace = TestAccessPatterns::generate_trace(
+        TestAccessPatterns::generate_strided_access(0, 16, 4096), ACCESS_READ);
+    for (size_t i = 0; i < timed_trace.size(); ++i) {
+        timed_trace[i].cycle = 2 * i;
+    }
+    for (size_t num_mshrs : {1, 4, 16}) {
+        set_associative_cache timed_l1(block_size, cache_size, memory);
+        nonblocking_cache timed_cache(timed_l1, num_mshrs, 4, 100);
+        timed_cache.replay(timed_trace);
+        timed_cache.print_stats("Strided Scan, " + to_string(num_mshrs) + " MSHRs");
+    }
+
+    // Fill and writeback traffic of the cache scheduled on an 8-bank DRAM channel
+    // with 2 KB rows, with one cache access every 16 cycles
+    vector<trace_record> dram_trace = TestAccessPatterns::generate_trace(
+        TestAccessPatterns::generate_random_access(8192, memory_size), ACCESS_READ);
+    for (size_t i = 0; i < dram_trace.size(); i += 2) {
+        dram_trace[i].type = ACCESS_WRITE;
+        dram_trace[i].value = memory.memory_array[dram_trace[i].address];
+        dram_trace[i + 1].address = (dram_trace[i].address + block_size) % memory_size;
+    }
+    for (int open_page = 1; open_page >= 0; --open_page) {
+        cout << "\n--- DRAM Backend (" << (open_page ? "open" : "closed") << " page, FR-FCFS) ---\n";
+        dram_config config;
+        config.open_page = open_page;
+        config.row_size = 2048;
+        dram_model dram(config, block_size);
+        set_associative_cache dram_cache(block_size, cache_size, memory);
+        dram_cache.dram = &dram;
+        for (size_t i = 0; i < dram_trace.size(); ++i) {
+            dram.advance_to(16 * i);
+            if (dram_trace[i].type == ACCESS_WRITE) {
+                dram_cache.write_to_cache(dram_trace[i].address, dram_trace[i].value);
+            } else {
+                dram_cache.read_from_cache(dram_trace[i].address);
+            }
+        }
+        dram.drain();
+        dram.print_stats();
+    }
+
+    // TLBs and page walks in front of a 32 KB data cache on a 4 MB memory: a random
+    // walk over 4 MB touches a new 4 KB page almost every time, while 2 MB pages fit
+    // the whole footprint in two TLB entries
+    cout << "\n--- TLBs and Page Walks (64/512-entry TLBs, 16-entry walk cache) ---";
+    size_t mmu_memory_size = 4 << 20;
+    main_memory mmu_memory(mmu_memory_size);
+    vector<size_t> tlb_addresses = TestAccessPatterns::generate_random_access(20000, mmu_memory_size - (256 << 10));
+    for (int huge = 0; huge <= 1; ++huge) {
+        set_associative_cache mmu_cache(block_size, 32768, mmu_memory);
+        mmu translation(mmu_cache, 64, 512, 16, mmu_memory_size - (256 << 10), 256 << 10);
+        if (huge) {
+            translation.map_region(0, mmu_memory_size, PAGE_2M);
+        }
+        for (size_t addr : tlb_addresses) {
+            translation.read(addr);
+        }
+        translation.print_stats(huge ? "2 MB Pages" : "4 KB Pages");
+        mmu_cache.print_cache_stats(huge ? "Data Cache, 2 MB Pages" : "Data Cache, 4 KB Pages");
+    }
+
+    // A 60 KB virtual footprint looped over a physically indexed 64 KB cache: where
+    // the OS places the pages decides how many of them conflict in the same sets
+    cout << "\n--- Virtual-to-Physical Page Placement (64 KB cache, 1 MB memory) ---";
+    size_t vm_memory_size = 1 << 20;
+    main_memory vm_memory(vm_memory_size);
+    vector<size_t> footprint = TestAccessPatterns::generate_strided_access(0x7f0000000000ULL, block_size, 960);
+    vector<size_t> vm_addresses = TestAccessPatterns::generate_round_robin_access(footprint, 8 * footprint.size());
+    for (int policy = ALLOC_SEQUENTIAL; policy <= ALLOC_PAGE_COLORING; ++policy) {
+        set_associative_cache vm_cache(block_size, 65536, vm_memory);
+        address_translator translator(4096, vm_memory_size, vm_cache.num_sets * block_size,
+                                      (frame_allocation_policy)policy, 7);
+        vm_cache.translator = &translator;
+        for (size_t addr : vm_addresses) {
+            vm_cache.read_from_cache(addr);
+        }
+        vm_cache.print_cache_stats("60 KB Loop");
+        translator.print_stats();
+    }
+
+    // Two accesses per cycle to an 8-bank L1 under block and word interleaving
+    cout << "\n--- Banked Cache (8 banks, 2-wide issue) ---";
+    vector<trace_record> word_trace = TestAccessPatterns::generate_trace(
+        TestAccessPatterns::generate_strided_access(0, 8, 2048), ACCESS_READ);
+    vector<trace_record> block_trace = TestAccessPatterns::generate_trace(
+        TestAccessPatterns::generate_strided_access(0, 64, 1024), ACCESS_READ);
+    for (int interleaving = BANK_BY_BLOCK; interleaving <= BANK_BY_WORD; ++interleaving) {
+        set_associative_cache banked_l1(block_size, cache_size, memory);
+        banked_cache banks(banked_l1, 8, (bank_interleaving)interleaving, 2);
+        banks.replay(word_trace);
+        banks.print_stats("8-Byte Stride");
+        banks.reset_stats();
+        banks.replay(block_trace);
+        banks.print_stats("64-Byte Stride");
+    }
+
+    // Lackey-format trace of a loop that calls a helper and walks an array, replayed
+    // through split 1 KB L1I and 2 KB L1D caches over a unified 8 KB L2
+    cout << "\n--- Split L1I/L1D (1 KB / 2 KB) over Unified L2 (8 KB) ---";
+    ostringstream lackey;
+    lackey << "==1234== Lackey, an example Valgrind tool\n";
+    for (size_t iter = 0; iter < 512; ++iter) {
+        size_t pc = 0x1000;
+        for (size_t i = 0; i < 24; ++i) {
+            size_t length = i % 2 ? 4 : 3;
+            lackey << "I  " << hex << pc << "," << dec << length << "\n";
+            pc += length;
+            if (i == 6) {
+                lackey << " L " << hex << 0x8000 + iter * 24 % 6144 << "," << dec << 8 << "\n";
+            } else if (i == 12) {
+                lackey << " M " << hex << 0xc000 + iter * 8 % 4096 << "," << dec << 8 << "\n";
+            } else if (i == 18) {
+                for (size_t j = 0; j < 48; ++j) {
+                    lackey << "I  " << hex << 0x3000 + (iter % 4) * 1024 + j * 4 << "," << dec << 4 << "\n";
+                }
+            }
+        }
+    }
+    istringstream lackey_in(lackey.str());
+    vector<trace_record> lackey_trace = read_lackey_trace(lackey_in);
+    {
+        set_associative_cache l1i(block_size, 1024, memory), l1d(block_size, 2048, memory), l2(block_size, 8192, memory);
+        split_l1_front_end front_end(l1i, l1d, l2);
+        front_end.replay(lackey_trace);
+        front_end.print_stats("Lackey Loop Trace");
+    }
+
+    // A 4 KB hot set reused between 4 KB block copies, with and without hints on the
+    // copy; hot-set misses show the pollution the hints remove
+    const char* hint_names[] = {"No Hints", "Non-temporal Copy", "Evict-first Copy", "Prefetch-only Ahead of Loads"};
+    for (int config = 0; config < 4; ++config) {
+        cout << "\n--- Streaming Copy: " << hint_names[config] << " ---";
+        vector<trace_record> copy_trace;
+        vector<bool> hot_record;
+        for (size_t iter = 0; iter < 8; ++iter) {
+            for (size_t addr = 0; addr < 4096; addr += 64) {
+                copy_trace.push_back({addr, ACCESS_READ, 0, 0, 1, HINT_NONE, 0});
+                hot_record.push_back(true);
+            }
+            size_t src = 0x2000 + iter * 4096, dst = 0xa000 + iter % 4 * 4096;
+            for (size_t offset = 0; offset < 4096; offset += 8) {
+                access_hint copy_hint = config == 1 ? HINT_NON_TEMPORAL : config == 2 ? HINT_EVICT_FIRST : HINT_NONE;
+                if (config == 3 && offset % 64 == 0 && offset + 256 < 4096) {
+                    copy_trace.push_back({src + offset + 256, ACCESS_READ, 0, 0, 1, HINT_PREFETCH_ONLY, 0});
+                    hot_record.push_back(false);
+                }
+                copy_trace.push_back({src + offset, ACCESS_READ, 0, 0, 1, copy_hint, 0});
+                copy_trace.push_back({dst + offset, ACCESS_WRITE, memory.memory_array[src + offset], 0, 1, copy_hint, 0});
+                hot_record.push_back(false);
+                hot_record.push_back(false);
+            }
+        }
+        set_associative_cache hint_cache(block_size, cache_size, memory);
+        write_buffer copy_buffer(block_size, 8, memory);
+        hint_cache.write_buf = &copy_buffer;
+        int hot_misses = 0;
+        for (size_t i = 0; i < copy_trace.size(); ++i) {
+            hint_cache.access(copy_trace[i]);
+            hot_misses += hot_record[i] && !hint_cache.last_access_hit;
+        }
+        hint_cache.print_cache_stats("Hot Set + Block Copy");
+        copy_buffer.print_stats();
+        cout << "Hot-set Misses: " << hot_misses << "\n";
+    }
+
+    // A 2 KB lookup table probed between the reads of a 32 KB scan: unprotected,
+    // locked line by line, and held in fully reserved sets (cache-as-RAM)
+    const char* lock_names[] = {"No Locking", "2 KB Table Locked", "Cache-as-RAM (4 ways of 8 sets)"};
+    vector<size_t> table_probes = TestAccessPatterns::generate_random_access(4096, 2048);
+    for (int config = 0; config < 3; ++config) {
+        cout << "\n--- Locked Lookup Table: " << lock_names[config] << " ---";
+        set_associative_cache lock_cache(block_size, cache_size, memory);
+        if (config == 2) {
+            lock_cache.reserve_ways(0, 8, 0xf);
+        }
+        for (size_t addr = 0; config != 0 && addr < 2048; addr += block_size) {
+            lock_cache.lock_block(config == 2 ? addr % 512 + addr / 512 * 8192 : addr);
+        }
+        int table_misses = 0;
+        for (size_t i = 0; i < table_probes.size(); ++i) {
+            size_t entry = table_probes[i];
+            lock_cache.read_from_cache(config == 2 ? entry % 512 + entry / 512 * 8192 : entry);
+            table_misses += !lock_cache.last_access_hit;
+            for (size_t j = 0; j < 8; ++j) {
+                lock_cache.read_from_cache(16384 + (i * 8 + j) * 16 % 32768);
+            }
+        }
+        lock_cache.print_cache_stats("Table Probes + 32 KB Scan");
+        cout << "Table Misses: " << table_misses << "\n";
+    }
+
+    // An 8 KB copy with 32-byte loads and stores, block aligned and misaligned by 16
+    // bytes; every other misaligned access spans two blocks
+    for (size_t misalignment : {0, 16}) {
+        cout << "\n--- 32-Byte Copy (" << (misalignment ? "misaligned" : "aligned") << ") ---";
+        set_associative_cache copy_cache(block_size, cache_size, memory);
+        uint8_t vector_register[32];
+        for (size_t offset = 0; offset < 8192; offset += 32) {
+            copy_cache.read(misalignment + offset, 32, vector_register);
+            copy_cache.write(0x8000 + misalignment + offset, 32, vector_register);
+        }
+        copy_cache.print_cache_stats("8 KB Copy");
+    }
+
+    // DMA round trip replayed from a trace: the CPU fills a 4 KB buffer and cleans it
+    // for the device, the device overwrites it in memory, and the CPU reads it back
+    // with and without invalidating first; then a 32 KB flush larger than the cache
+    for (int invalidate = 0; invalidate < 2; ++invalidate) {
+        cout << "\n--- DMA Buffer " << (invalidate ? "with" : "without") << " Invalidation ---";
+        set_associative_cache dma_cache(block_size, cache_size, memory);
+        vector<trace_record> cpu_writes, cpu_reads;
+        for (size_t addr = 0x4000; addr < 0x5000; addr += 8) {
+            cpu_writes.push_back({addr, ACCESS_WRITE, 0xaa, 0, 8, HINT_NONE, 0});
+            cpu_reads.push_back({addr, ACCESS_READ, 0, 0, 8, HINT_NONE, 0});
+        }
+        cpu_writes.push_back({0x4000, ACCESS_CLEAN, 0, 0, 4096, HINT_NONE, 0});
+        if (invalidate) {
+            cpu_reads.insert(cpu_reads.begin(), {0x4000, ACCESS_INVALIDATE, 0, 0, 4096, HINT_NONE, 0});
+        }
+        for (const trace_record& record : cpu_writes) {
+            dma_cache.access(record);
+        }
+        memset(&memory.memory_array[0x4000], 0x55, 4096);  // Device writes the buffer
+        int stale_reads = 0;
+        uint8_t word[8];
+        for (const trace_record& record : cpu_reads) {
+            if (record.type == ACCESS_READ) {
+                dma_cache.read(record.address, 8, word);
+                stale_reads += word[0] != 0x55;
+            } else {
+                dma_cache.access(record);
+            }
+        }
+        dma_cache.flush_range(0, 32768);
+        dma_cache.print_cache_stats("DMA Round Trip + 32 KB Flush");
+        cout << "Stale Reads: " << stale_reads << "\n";
+    }
+
+    // Four cores with private 2 KB caches: each walks its own 1 KB region, all read a
+    // shared 512-byte table and take turns updating a shared counter block.
+    // Broadcast probing against snoop filters of half and twice the private capacity.
+    size_t filter_entries[] = {0, 64, 256};
+    for (size_t entries : filter_entries) {
+        cout << "\n--- Coherence: " << (entries ? to_string(entries) + "-Entry Snoop Filter" : string("Broadcast")) << " ---";
+        vector<set_associative_cache> private_caches(4, set_associative_cache(block_size, 2048, memory));
+        vector<set_associative_cache*> core_caches;
+        for (set_associative_cache& private_cache : private_caches) {
+            core_caches.push_back(&private_cache);
+        }
+        snoop_filter filter(entries ? entries : NUM_WAYS);
+        private_cache_system system(core_caches, entries ? &filter : nullptr);
+        for (size_t step = 0; step < 4096; ++step) {
+            for (size_t core = 0; core < 4; ++core) {
+                size_t own = 0x8000 + core * 4096 + step * 8 % 1024;
+                system.access(core, {own, ACCESS_WRITE, (uint8_t)step, 0, 8, HINT_NONE, 0});
+                system.access(core, {0x6000 + (step * 40 + core * 128) % 512, ACCESS_READ, 0, 0, 8, HINT_NONE, 0});
+                if (step % 16 == core) {
+                    system.access(core, {0x7000, ACCESS_WRITE, (uint8_t)step, 0, 8, HINT_NONE, 0});
+                }
+            }
+        }
+        system.print_stats("Private + Shared Data");
+    }
+
+    // 4x4 mesh of 2 KB LLC slices with cores on the corner tiles. Each core keeps
+    // reading its own 1 KB table; static placement replays the slices on parallel
+    // threads, migration pulls the tables toward their cores.
+    for (int migrate = 0; migrate < 2; ++migrate) {
+        cout << "\n--- NUCA LLC (" << (migrate ? "Hot-block Migration" : "Static, Parallel Slices") << ") ---";
+        nuca_cache llc(4, 4, block_size, 2048, memory, {0, 3, 12, 15});
+        llc.migration = migrate;
+        vector<pair<size_t, trace_record>> nuca_trace;
+        for (size_t step = 0; step < 8192; ++step) {
+            size_t core = step % 4;
+            size_t addr = 0x8000 + core * 4096 + (step / 4 * 72) % 1024;
+            nuca_trace.push_back({core, {addr, ACCESS_READ, 0, 0, 8, HINT_NONE, 0}});
+        }
+        llc.replay(nuca_trace);
+        llc.print_stats("Per-core 1 KB Tables");
+    }
+
+    // 256 MB DRAM caches under an 8 MB hot region (70% of accesses, a third of them
+    // writes) mixed with a 1 GB scan from a different PC, with and without a miss
+    // predictor. Only metadata is simulated, so addresses need no backing memory.
+    vector<pair<size_t, bool>> l4_trace;
+    vector<size_t> l4_pcs;
+    mt19937 l4_gen(42);
+    for (size_t i = 0, scan = 0; i < 1000000; ++i) {
+        if (l4_gen() % 10 < 7) {
+            l4_trace.push_back({(size_t)(l4_gen() % (8 << 20)) & ~(size_t)63, l4_gen() % 3 == 0});
+            l4_pcs.push_back(0x401000);
+        } else {
+            l4_trace.push_back({((size_t)1 << 30) + scan++ * 64 % ((size_t)1 << 30), false});
+            l4_pcs.push_back(0x402000);
+        }
+    }
+    for (int organization = DRAM_CACHE_ALLOY; organization <= DRAM_CACHE_SET_ASSOCIATIVE; ++organization) {
+        for (int predict = 0; predict < 2; ++predict) {
+            dram_cache l4((dram_cache_organization)organization, (size_t)256 << 20, block_size, 16, predict);
+            for (size_t i = 0; i < l4_trace.size(); ++i) {
+                l4.access(l4_trace[i].first, l4_trace[i].second, l4_pcs[i]);
+            }
+            l4.print_stats("Hot Region + Scan");
+        }
+    }
+
+    // Storage engine transactions on 32 KB of persistent memory: append a 128-byte log
+    // record, then update an 8-byte index entry. Without flushes, with clwb and sfence
+    // per record, with one sfence per 8 records, and with a 16-entry combining buffer.
+    const char* pmem_names[] = {"No Flushes", "clwb + sfence per Record", "clwb, sfence per 8 Records",
+                                "clwb + sfence per Record, 16-Entry Combining Buffer"};
+    for (int config = 0; config < 4; ++config) {
+        cout << "\n--- Persistent Memory: " << pmem_names[config] << " ---\n";
+        vector<trace_record> engine_trace;
+        for (size_t tx = 0; tx < 2000; ++tx) {
+            size_t log_entry = 0x8000 + tx * 128 % 16384, index_entry = 0xc000 + (tx * 2654435761u) % 2048 * 8;
+            engine_trace.push_back({log_entry, ACCESS_WRITE, (uint8_t)tx, 0, 128, HINT_NONE, 0});
+            if (config != 0) {
+                engine_trace.push_back({log_entry, ACCESS_CLEAN, 0, 0, 128, HINT_NONE, 0});
+                if (config != 2) {
+                    engine_trace.push_back({0, ACCESS_FENCE, 0, 0, 0, HINT_NONE, 0});
+                }
+            }
+            engine_trace.push_back({index_entry, ACCESS_WRITE, (uint8_t)tx, 0, 8, HINT_NONE, 0});
+            if (config != 0) {
+                engine_trace.push_back({index_entry, ACCESS_CLEAN, 0, 0, 8, HINT_NONE, 0});
+                if (config != 2 || tx % 8 == 7) {
+                    engine_trace.push_back({0, ACCESS_FENCE, 0, 0, 0, HINT_NONE, 0});
+                }
+            }
+        }
+        set_associative_cache pmem_cache(block_size, cache_size, memory);
+        pmem_tracker tracker(0x8000, 0x10000, block_size, 256, config == 3 ? 16 : 0);
+        pmem_cache.pmem = &tracker;
+        for (const trace_record& record : engine_trace) {
+            pmem_cache.access(record);
+        }
+        tracker.drain();
+        tracker.print_stats();
+    }
+
+    // Three processes time-sliced on one cache: two loop over 2 KB working sets and
+    // the third streams through 32 KB; the second one writes. ASID-tagged lines survive a context switch;
+    // flush-on-switch starts every quantum cold.
+    vector<vector<trace_record>> processes;
+    for (size_t p = 0; p < 2; ++p) {
+        vector<size_t> loop;
+        for (size_t i = 0; i < 12000; ++i) {
+            loop.push_back(0x4000 + p * 0x800 + i * 16 % 0x800);
+        }
+        processes.push_back(TestAccessPatterns::generate_trace(loop, p == 0 ? ACCESS_READ : ACCESS_WRITE));
+    }
+    processes.push_back(TestAccessPatterns::generate_trace(
+        TestAccessPatterns::generate_strided_access(0x8000, 8, 4096), ACCESS_READ));
+    for (size_t quantum : {200, 2000}) {
+        vector<trace_record> schedule = TestAccessPatterns::schedule_processes(processes, quantum);
+        for (int mode = ASID_TAGGED; mode <= ASID_FLUSH_ON_SWITCH; ++mode) {
+            set_associative_cache process_cache(block_size, cache_size, memory);
+            process_cache.asid_policy = (asid_mode)mode;
+            for (const trace_record& record : schedule) {
+                process_cache.access(record);
+            }
+            process_cache.print_cache_stats("Time-sliced Processes, Quantum " + to_string(quantum));
+        }
+    }
+
+    // Three processes storing their ASID over the same 2 KB of virtual addresses and
+    // reading it back, each backed by its own 16 KB of memory. ASID-tagged copies of
+    // one virtual block coexist instead of evicting each other.
+    vector<vector<trace_record>> homonym_processes(3);
+    for (size_t p = 0; p < 3; ++p) {
+        for (size_t pass = 0; pass < 8; ++pass) {
+            for (size_t addr = 0; addr < 0x800; addr += 16) {
+                homonym_processes[p].push_back({addr, pass ? ACCESS_READ : ACCESS_WRITE, (uint8_t)(p + 1), 0, 1,
+                                                HINT_NONE, 0});
+            }
+        }
+    }
+    vector<trace_record> homonym_schedule = TestAccessPatterns::schedule_processes(homonym_processes, 128);
+    for (int mode = ASID_TAGGED; mode <= ASID_FLUSH_ON_SWITCH; ++mode) {
+        main_memory process_memory(4 * 16384);
+        set_associative_cache homonym_cache(block_size, cache_size, process_memory);
+        homonym_cache.asid_policy = (asid_mode)mode;
+        homonym_cache.asid_region = 16384;
+        bool own_data = true;
+        for (const trace_record& record : homonym_schedule) {
+            if (record.type == ACCESS_READ) {
+                own_data = own_data && homonym_cache.read_from_cache(record.address) == record.asid;
+            } else {
+                homonym_cache.access(record);
+            }
+        }
+        homonym_cache.print_cache_stats("Processes Sharing Virtual Addresses");
+        cout << "Every process reads its own data: " << (own_data ? "yes" : "no") << "\n";
+    }
+
+    cout << "\n--- 16-Way Tree PLRU (" << wide_set_associative_cache::simd_path() << " tag scan) ---";
+    wide_set_associative_cache wide_cache(block_size, cache_size, memory, 16);
+    run_access_patterns(wide_cache, patterns);
+
+    cout << "\n--- 20-Way Bit-PLRU (" << wide_set_associative_cache::simd_path() << " tag scan) ---";
+    wide_set_associative_cache wide_bit_cache(block_size, cache_size, memory, 20);
+    run_access_patterns(wide_bit_cache, patterns);
+
     return 0;
 }
\ No newline at end of file